@@ -37,10 +37,20 @@ gentype clampToNearestNeighbors(const gentype value, const __global gentype* sta
 {
 	int3 minBound = (int3)(position.x, position.y, position.z);
 	
-	minBound.x = clamp(minBound.x, 0, (int)get_global_size(0) - 2);
-	minBound.y = clamp(minBound.y, 0, (int)get_global_size(1) - 2);
-	minBound.z = clamp(minBound.z, 0, (int)get_global_size(2) - 2);
+	minBound.x = clamp(minBound.x, 0, GRID_WIDTH - 2);
+	minBound.y = clamp(minBound.y, 0, GRID_HEIGHT - 2);
 	
+#if DIMENSIONS == 2
+	gentype state0 = stateGrid[getElementAt(minBound.x, minBound.y, 0)];
+	gentype state1 = stateGrid[getElementAt(minBound.x+1, minBound.y, 0)];
+	gentype state2 = stateGrid[getElementAt(minBound.x, minBound.y+1, 0)];
+	gentype state3 = stateGrid[getElementAt(minBound.x+1, minBound.y+1, 0)];
+
+	gentype minState = min(min(min(state0, state1), state2), state3);
+	gentype maxState = max(max(max(state0, state1), state2), state3);
+#else
+	minBound.z = clamp(minBound.z, 0, GRID_DEPTH - 2);
+
 	gentype state0 = stateGrid[getElementAt(minBound.x, minBound.y, minBound.z)];
 	gentype state1 = stateGrid[getElementAt(minBound.x+1, minBound.y, minBound.z)];
 	gentype state2 = stateGrid[getElementAt(minBound.x, minBound.y+1, minBound.z)];
@@ -52,6 +62,7 @@ gentype clampToNearestNeighbors(const gentype value, const __global gentype* sta
 
 	gentype minState = min(min(min(min(min(min(min(state0, state1), state2), state3), state4), state5), state6), state7);
 	gentype maxState = max(max(max(max(max(max(max(state0, state1), state2), state3), state4), state5), state6), state7);
+#endif
 	
 	return clamp(value, minState, maxState);
 }
@@ -0,0 +1,45 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef GRID_DIMENSIONS_H
+#define GRID_DIMENSIONS_H
+
+// Grid dimensions can be passed in as program build options (e.g -D GRID_WIDTH=64) so that strides and bounds
+// become compile time constants. If they are not defined, they are read from the kernel's global work size.
+#ifndef GRID_WIDTH
+#define GRID_WIDTH ((int)get_global_size(0))
+#endif
+
+#ifndef GRID_HEIGHT
+#define GRID_HEIGHT ((int)get_global_size(1))
+#endif
+
+#ifndef GRID_DEPTH
+#define GRID_DEPTH ((int)get_global_size(2))
+#endif
+
+// DIMENSIONS=2 removes all z neighbour lookups and z clamping. Grid depth must be 1.
+#ifndef DIMENSIONS
+#define DIMENSIONS 3
+#endif
+
+#define GRID_STRIDE_Z (GRID_WIDTH * GRID_HEIGHT)
+
+#endif // GRID_DIMENSIONS_H
@@ -18,6 +18,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include "GridDimensions.h"
+
 #define DEFINE_NEIGHBORS_STRUCT(STRUCT_NAME, DATA_TYPE) \
 typedef struct \
 { \
@@ -32,33 +34,71 @@ typedef struct \
 
 int getElement()
 {
-	return get_global_id(0) + get_global_id(1) * get_global_size(0) + get_global_id(2) * get_global_size(0) * get_global_size(1);
+#if DIMENSIONS == 2
+	return get_global_id(0) + get_global_id(1) * GRID_WIDTH;
+#else
+	return get_global_id(0) + get_global_id(1) * GRID_WIDTH + get_global_id(2) * GRID_STRIDE_Z;
+#endif
 }
 
 int getElementAt(int x, int y, int z)
 {
-	x = clamp(x, 0, (int)get_global_size(0) - 1);
-	y = clamp(y, 0, (int)get_global_size(1) - 1);
-	z = clamp(z, 0, (int)get_global_size(2) - 1);
-	return x + y * get_global_size(0) + z * get_global_size(0) * get_global_size(1);
+	x = clamp(x, 0, GRID_WIDTH - 1);
+	y = clamp(y, 0, GRID_HEIGHT - 1);
+#if DIMENSIONS == 2
+	return x + y * GRID_WIDTH;
+#else
+	z = clamp(z, 0, GRID_DEPTH - 1);
+	return x + y * GRID_WIDTH + z * GRID_STRIDE_Z;
+#endif
 }
 
 float3 getPosition()
 {
+#if DIMENSIONS == 2
+	return (float3)(get_global_id(0), get_global_id(1), 0);
+#else
 	return (float3)(get_global_id(0), get_global_id(1), get_global_id(2));
+#endif
 }
 
+#if DIMENSIONS == 2
+
+// 2D grids have no up/down neighbours. They are set to the centre value so that
+// zero gradient boundary conditions apply along z.
 #define RETURN_NEIGHBORS_STRUCT_GENERIC(NEIGHBORS_STRUCT_TYPE, GRID) \
-	int maxX = get_global_size(0) - 1; \
-	int maxY = get_global_size(1) - 1; \
-	int maxZ = get_global_size(2) - 1; \
+	int maxX = GRID_WIDTH - 1; \
+	int maxY = GRID_HEIGHT - 1; \
 	\
-	int strideZ = get_global_size(0) * get_global_size(1); \
 	int elementC = getElement(); \
 	int elementW = (get_global_id(0) > 0) ? elementC - 1 : elementC; \
 	int elementE = (get_global_id(0) < maxX) ? elementC + 1 : elementC; \
-	int elementN = (get_global_id(1) > 0) ? elementC - get_global_size(0) : elementC; \
-	int elementS = (get_global_id(1) < maxY) ? elementC + get_global_size(0) : elementC; \
+	int elementN = (get_global_id(1) > 0) ? elementC - GRID_WIDTH : elementC; \
+	int elementS = (get_global_id(1) < maxY) ? elementC + GRID_WIDTH : elementC; \
+	\
+	NEIGHBORS_STRUCT_TYPE n; \
+	n.c = grid[elementC]; \
+	n.n = grid[elementN]; \
+	n.s = grid[elementS]; \
+	n.e = grid[elementE]; \
+	n.w = grid[elementW]; \
+	n.u = n.c; \
+	n.d = n.c; \
+	return n;
+
+#else
+
+#define RETURN_NEIGHBORS_STRUCT_GENERIC(NEIGHBORS_STRUCT_TYPE, GRID) \
+	int maxX = GRID_WIDTH - 1; \
+	int maxY = GRID_HEIGHT - 1; \
+	int maxZ = GRID_DEPTH - 1; \
+	\
+	int strideZ = GRID_STRIDE_Z; \
+	int elementC = getElement(); \
+	int elementW = (get_global_id(0) > 0) ? elementC - 1 : elementC; \
+	int elementE = (get_global_id(0) < maxX) ? elementC + 1 : elementC; \
+	int elementN = (get_global_id(1) > 0) ? elementC - GRID_WIDTH : elementC; \
+	int elementS = (get_global_id(1) < maxY) ? elementC + GRID_WIDTH : elementC; \
 	int elementD = (get_global_id(2) > 0) ? elementC - strideZ : elementC; \
 	int elementU = (get_global_id(2) < maxZ) ? elementC + strideZ : elementC; \
 	\
@@ -70,4 +110,6 @@ float3 getPosition()
 	n.w = grid[elementW]; \
 	n.u = grid[elementU]; \
 	n.d = grid[elementD]; \
-	return n;
\ No newline at end of file
+	return n;
+
+#endif
\ No newline at end of file
@@ -18,15 +18,42 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include "GridDimensions.h"
+
+#if DIMENSIONS == 2
+
+// Bilinear interpolation in the xy plane. The z component of POS is ignored.
+#define RETURN_VALUE_TRILINEAR_GENERIC(DATA_TYPE, GRID, POS) \
+	POS.xy = clamp(POS.xy, (float2)(0.001f, 0.001f), (float2)((float)GRID_WIDTH - 0.001f, (float)GRID_HEIGHT - 0.001f)); \
+	int x0 = (int)POS.x; \
+	int y0 = (int)POS.y; \
+	\
+	int x1 = min(x0 + 1, GRID_WIDTH - 1); \
+	int y1 = min(y0 + 1, GRID_HEIGHT - 1); \
+	\
+	float fracX = POS.x - (float)x0; \
+	float fracY = POS.y - (float)y0; \
+	\
+	DATA_TYPE v00 = GRID[x0 + y0 * GRID_WIDTH]; \
+	DATA_TYPE v10 = GRID[x1 + y0 * GRID_WIDTH]; \
+	DATA_TYPE v01 = GRID[x0 + y1 * GRID_WIDTH]; \
+	DATA_TYPE v11 = GRID[x1 + y1 * GRID_WIDTH]; \
+	\
+	DATA_TYPE v0 = v00 + fracX * (v10 - v00); \
+	DATA_TYPE v1 = v01 + fracX * (v11 - v01); \
+	return v0 + fracY * (v1 - v0);
+
+#else
+
 #define RETURN_VALUE_TRILINEAR_GENERIC(DATA_TYPE, GRID, POS) \
-	POS = clamp(POS, (float3)(0.001f, 0.001f, 0.001f), (float3)((float)get_global_size(0) - 0.001f, (float)get_global_size(1) - 0.001f, (float)get_global_size(2) - 0.001f)); \
+	POS = clamp(POS, (float3)(0.001f, 0.001f, 0.001f), (float3)((float)GRID_WIDTH - 0.001f, (float)GRID_HEIGHT - 0.001f, (float)GRID_DEPTH - 0.001f)); \
 	int x0 = (int)POS.x; \
 	int y0 = (int)POS.y; \
 	int z0 = (int)POS.z; \
 	\
-	int maxX = get_global_size(0)-1; \
-	int maxY = get_global_size(1)-1; \
-	int maxZ = get_global_size(2)-1; \
+	int maxX = GRID_WIDTH-1; \
+	int maxY = GRID_HEIGHT-1; \
+	int maxZ = GRID_DEPTH-1; \
 	\
 	int x1 = min(x0 + 1, maxX); \
 	int y1 = min(y0 + 1, maxY); \
@@ -36,15 +63,15 @@
 	float fracY = POS.y - (float)y0; \
 	float fracZ = POS.z - (float)z0; \
 	\
-	int strideZ = get_global_size(0) * get_global_size(1); \
-	DATA_TYPE v000 = GRID[x0 + y0 * get_global_size(0) + z0 * strideZ]; \
-	DATA_TYPE v100 = GRID[x1 + y0 * get_global_size(0) + z0 * strideZ]; \
-	DATA_TYPE v010 = GRID[x0 + y1 * get_global_size(0) + z0 * strideZ]; \
-	DATA_TYPE v110 = GRID[x1 + y1 * get_global_size(0) + z0 * strideZ]; \
-	DATA_TYPE v001 = GRID[x0 + y0 * get_global_size(0) + z1 * strideZ]; \
-	DATA_TYPE v101 = GRID[x1 + y0 * get_global_size(0) + z1 * strideZ]; \
-	DATA_TYPE v011 = GRID[x0 + y1 * get_global_size(0) + z1 * strideZ]; \
-	DATA_TYPE v111 = GRID[x1 + y1 * get_global_size(0) + z1 * strideZ]; \
+	int strideZ = GRID_STRIDE_Z; \
+	DATA_TYPE v000 = GRID[x0 + y0 * GRID_WIDTH + z0 * strideZ]; \
+	DATA_TYPE v100 = GRID[x1 + y0 * GRID_WIDTH + z0 * strideZ]; \
+	DATA_TYPE v010 = GRID[x0 + y1 * GRID_WIDTH + z0 * strideZ]; \
+	DATA_TYPE v110 = GRID[x1 + y1 * GRID_WIDTH + z0 * strideZ]; \
+	DATA_TYPE v001 = GRID[x0 + y0 * GRID_WIDTH + z1 * strideZ]; \
+	DATA_TYPE v101 = GRID[x1 + y0 * GRID_WIDTH + z1 * strideZ]; \
+	DATA_TYPE v011 = GRID[x0 + y1 * GRID_WIDTH + z1 * strideZ]; \
+	DATA_TYPE v111 = GRID[x1 + y1 * GRID_WIDTH + z1 * strideZ]; \
 	\
 	DATA_TYPE v00 = v000 + fracX * (v100 - v000); \
 	DATA_TYPE v10 = v010 + fracX * (v110 - v010); \
@@ -52,4 +79,6 @@
 	DATA_TYPE v11 = v011 + fracX * (v111 - v011); \
 	DATA_TYPE v0 = v00 + fracY * (v10 - v00); \
 	DATA_TYPE v1 = v01 + fracY * (v11 - v01); \
-	return v0 + fracZ * (v1 - v0);
\ No newline at end of file
+	return v0 + fracZ * (v1 - v0);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef OBJECT_UNIFORMS_H
+#define OBJECT_UNIFORMS_H
+
+// Values constant for all renderables of one scene node.
+// Must match GVis::ObjectUniformBlock.
+layout(std140) uniform ObjectUniforms
+{
+	mat4 modelViewProj;
+	mat4 invModelMat;
+	mat4 shadowModelViewProj;
+	mat4 invShadowViewProj;
+	vec3 cameraPosition_modelSpace;
+	vec3 cameraDirection_modelSpace; // direction to camera
+	vec3 cameraForwardDirection_modelSpace; // direction of camera
+	vec3 lightDirection_modelSpace; // direction to light
+	float shadowMaxClipSpaceDepth;
+};
+
+#endif
@@ -20,7 +20,7 @@
 
 #version 330 core
 
-uniform float maxClipSpaceDepth;
+#include "FrameUniforms.h"
 
 out vec3 color;
 
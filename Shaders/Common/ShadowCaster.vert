@@ -22,7 +22,7 @@
 
 layout(location = 0) in vec4 vertexPosition_modelSpace;
 
-uniform mat4 modelViewProj;
+#include "ObjectUniforms.h"
 
 void main()
 {
@@ -137,7 +137,7 @@ float getVisibility_poisson(sampler2D shadowSampler, vec3 shadowTexcoord)
 }
 
 
-uniform float shadowMaxClipSpaceDepth;
+#include "ObjectUniforms.h"
 
 vec3 getShadowTexcoord(vec3 position_shadowSpace)
 {
@@ -27,7 +27,7 @@ in vec3 normal;
 out vec3 color;
 
 uniform sampler2D albedoSampler;
-uniform vec3 lightDirection_modelSpace;
+#include "ObjectUniforms.h"
 uniform vec3 ambient = vec3(0.015);
 
 void main()
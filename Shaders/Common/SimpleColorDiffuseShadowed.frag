@@ -29,7 +29,7 @@ in vec4 position_shadowSpace;
 out vec3 color;
 
 uniform sampler2D shadowSampler;
-uniform vec3 lightDirection_modelSpace;
+#include "ObjectUniforms.h"
 
 const vec3 ambient = vec3(0.015);
 
@@ -27,7 +27,7 @@ layout(location = 2) in vec3 vertexNormal;
 out vec3 texCoord;
 out vec3 normal;
 
-uniform mat4 modelViewProj;
+#include "ObjectUniforms.h"
 
 void main()
 {
@@ -29,9 +29,7 @@ out vec3 normal;
 out vec3 lightDirection;
 out vec4 position_shadowSpace;
 
-uniform mat4 modelViewProj;
-uniform vec3 lightDirection_modelSpace;
-uniform mat4 shadowModelViewProj;
+#include "ObjectUniforms.h"
 
 void main()
 {
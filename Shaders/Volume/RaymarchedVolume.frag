@@ -36,13 +36,11 @@ uniform sampler3D albedoSampler;
 uniform sampler2D sceneDepthSampler;
 uniform sampler2D shadowSampler;
 
-uniform mat4 shadowModelViewProj;
+#include "../Common/FrameUniforms.h"
+#include "../Common/ObjectUniforms.h"
 
 uniform vec3 volumeSize_modelSpace;
-uniform vec3 cameraPosition_modelSpace;
 uniform vec3 oneOnVolumeTextureSize;
-uniform float maxClipSpaceDepth;
-uniform vec2 viewportResolution;
 
 uniform float opacityMultiplier = 5.0f;
 uniform vec3 diffuseColor = vec3(1);
@@ -26,7 +26,7 @@ layout(location = 1) in vec3 vertexTexCoord;
 out vec3 texCoord;
 out vec3 position_modelSpace;
 
-uniform mat4 modelViewProj;
+#include "../Common/ObjectUniforms.h"
 
 void main()
 {
@@ -30,15 +30,30 @@ in flat int nodeIndirectionBaseIndex;
 
 out vec4 color;
 
+// Atlases are 3d textures, or 2d array textures with one layer per voxel slice when block compressed
+#ifdef ALBEDO_ATLAS_ARRAY
+uniform sampler2DArray albedoSampler;
+#else
 uniform sampler3D albedoSampler;
+#endif
+
+#ifdef NORMAL_ATLAS_ARRAY
+uniform sampler2DArray normalSampler;
+#else
 uniform sampler3D normalSampler;
+#endif
+
+#ifdef TEMPERATURE_ATLAS_ARRAY
+uniform sampler2DArray temperatureSampler;
+#else
 uniform sampler3D temperatureSampler;
+#endif
+
 uniform sampler2D temperatureRampSampler;
 uniform isamplerBuffer nodeIndirectionSampler;
 
 uniform float maxDepth;
-uniform vec3 cameraPosition_modelSpace;
-uniform vec3 lightDirection_modelSpace;
+#include "../Common/ObjectUniforms.h"
 
 uniform vec3 volumeSize_modelSpace;
 uniform vec3 oneOnVolumeTextureSize;
@@ -46,11 +61,18 @@ uniform vec3 oneOnVolumeTextureSize;
 uniform float thresholdAlpha = 0.001;
 uniform float opacityMultiplier = 500.0f;
 
-const float rayTerminationOpacity = 0.98f;
-const int maxIterationCount = 200;
+// Quality settings
+uniform float rayTerminationOpacity = 0.98; // ray will terminate when accumulated opacity reaches this value
+uniform int maxIterationCount = 200;
+uniform float stepDistanceGrowth = 0.0; // step size grows by this fraction per model space unit of distance from the camera
+uniform float lowDensityStepMultiplier = 1.0; // step size multiplier after a sample below thresholdAlpha
 
 uniform ivec3 maxLeafCountPerAtlasDimension;
 uniform int maxLeafCountPerInternalNodeDimension;
+uniform int leafVoxelCountPerDimension = 8;
+
+// Multiplies the raymarch step size. Lower resolution LOD levels use larger steps.
+uniform float stepSizeScale = 1.0;
 
 vec3 getLeafAtlasOffset(int atlasTextureIndex)
 {
@@ -62,17 +84,79 @@ vec3 getLeafAtlasOffset(int atlasTextureIndex)
 	return atlasCoord / maxLeafCountPerAtlasDimension;
 }
 
-int normalizedCoordToLinearOffset(vec3 pos)
+int leafCellToLinearOffset(ivec3 coord)
 {
-	ivec3 coord = clamp(ivec3(pos * float(maxLeafCountPerInternalNodeDimension)), ivec3(0), ivec3(15));
 	// VDB is indexed in zyx order
 	return coord.z + coord.y * maxLeafCountPerInternalNodeDimension + coord.x * maxLeafCountPerInternalNodeDimension * maxLeafCountPerInternalNodeDimension;
 }
 
+int countBits(uint v)
+{
+	v = v - ((v >> 1) & 0x55555555u);
+	v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+	return int((((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+}
+
+// Returns the atlas index of a leaf cell, or -1 if the cell has no leaf.
+// The node's header holds occupancy mask words followed by entry offsets. See GSparseVolumes::NodeIndirectionMap.
+int lookupLeafAtlasIndex(ivec3 coord)
+{
+	int leafIndex = leafCellToLinearOffset(coord);
+	int maxLeafCountPerInternalNode = maxLeafCountPerInternalNodeDimension * maxLeafCountPerInternalNodeDimension * maxLeafCountPerInternalNodeDimension;
+	int maskWordCount = (maxLeafCountPerInternalNode + 31) / 32;
+	int word = leafIndex / 32;
+	uint bit = 1u << uint(leafIndex % 32);
+
+	uint mask = uint(texelFetch(nodeIndirectionSampler, nodeIndirectionBaseIndex + word).r);
+	if ((mask & bit) == 0u)
+	{
+		return -1;
+	}
+
+	int entryOffset = texelFetch(nodeIndirectionSampler, nodeIndirectionBaseIndex + maskWordCount + word).r;
+	return texelFetch(nodeIndirectionSampler, entryOffset + countBits(mask & (bit - 1u))).r;
+}
+
+// Samples a 2d array atlas at a normalized 3d coordinate, filtering linearly between the two nearest layers.
+// Sample coordinates are kept half a voxel inside leaves, so both layers belong to the same leaf.
+vec4 sampleAtlas(sampler2DArray sampler, vec3 texCoord)
+{
+	float layer = texCoord.z * float(textureSize(sampler, 0).z) - 0.5;
+	float layer0 = floor(layer);
+	vec4 a = textureGrad(sampler, vec3(texCoord.xy, layer0), vec2(0), vec2(0));
+	vec4 b = textureGrad(sampler, vec3(texCoord.xy, layer0 + 1.0), vec2(0), vec2(0));
+	return mix(a, b, layer - layer0);
+}
+
+vec4 sampleAtlas(sampler3D sampler, vec3 texCoord)
+{
+	return textureGrad(sampler, texCoord, vec3(0), vec3(0));
+}
+
+#ifdef USE_OCTAHEDRAL_NORMALS
+// Normal atlas holds octahedral encoded normals in two channels (e.g BC5 compressed).
+// Returns the normal in the same n * 0.5 + 0.5 encoding as uncompressed normal atlases.
+vec3 sampleNormal(vec3 texCoord)
+{
+	vec2 e = sampleAtlas(normalSampler, texCoord).rg * 2.0 - 1.0;
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0 ? 1.0 : -1.0, n.y >= 0 ? 1.0 : -1.0);
+	}
+	return normalize(n) * 0.5 + 0.5;
+}
+#else
+vec3 sampleNormal(vec3 texCoord)
+{
+	return sampleAtlas(normalSampler, texCoord).rgb;
+}
+#endif
+
 vec4 accumulateColorOverRaySegment(vec4 color, vec3 texCoord, float alpha, float segmentLength)
 {
 #ifdef USE_NORMAL_SAMPLER
-	vec3 normal = normalize(textureGrad(normalSampler, texCoord, vec3(0), vec3(0)).rgb);
+	vec3 normal = normalize(sampleNormal(texCoord));
 	float lambert = calcLambert(lightDirection_modelSpace, normal, 0.3);
 #else
 	float lambert = 1.0;
@@ -80,7 +164,7 @@ vec4 accumulateColorOverRaySegment(vec4 color, vec3 texCoord, float alpha, float
 	
 	vec3 sampleColor = vec3(1) * lambert;
 	
-	float opacity = min(1.0, alpha * segmentLength);
+	float opacity = 1.0 - exp(-alpha * segmentLength);
 
 	vec4 result;
 	result.rgb = color.rgb + sampleColor.rgb * opacity * (1 - color.a);
@@ -91,10 +175,10 @@ vec4 accumulateColorOverRaySegment(vec4 color, vec3 texCoord, float alpha, float
 
 vec4 accumulateColorOverRaySegmentTemperatureMapped(vec4 color, vec3 texCoord, float alpha, float segmentLength)
 {
-	float temperature = texture(temperatureSampler, texCoord).r;
+	float temperature = sampleAtlas(temperatureSampler, texCoord).r;
 	vec3 sampleColor = textureGrad(temperatureRampSampler, vec2(temperature, 0.5), vec2(0), vec2(0)).rgb;
 	
-	float opacity = alpha * segmentLength;
+	float opacity = 1.0 - exp(-alpha * segmentLength);
 
 	vec4 result;
 	result.rgb = color.rgb + sampleColor.rgb * opacity * (1 - color.a);
@@ -107,39 +191,71 @@ void main()
 {
 	color = vec4(0);
 
-	vec3 stepSize = vec3(1.0 / 128.0); // TODO: use adaptive step sizes
+	// Base step. The step actually taken grows with distance from the camera and in low density regions.
+	float stepSize = stepSizeScale / 128.0;
 	vec3 step = normalize(position_modelSpace - cameraPosition_modelSpace) * stepSize;
 	vec3 step_modelSpace = step * volumeSize_modelSpace;
+	float stepLength_modelSpace = length(step_modelSpace);
 	vec3 pos = texCoord;
 
+	float distanceFromCamera = length(position_modelSpace - cameraPosition_modelSpace);
+	bool lowDensity = false;
+
 	float rayStartDepth = gl_FragCoord.z / (gl_FragCoord.w * maxDepth); // normalized linear depth
 	float normalizedLinearDepthStep = length(step_modelSpace) / maxDepth;
 	
 	vec3 texCoordScale =  vec3(1.0 / maxLeafCountPerAtlasDimension);
+	float halfVoxelInLeaf = 0.5 / float(leafVoxelCountPerDimension);
+	
+	float leafCellCount = float(maxLeafCountPerInternalNodeDimension);
+	vec3 stepInLeafCells = step * leafCellCount;
+	vec3 stepsPerLeafCell = 1.0 / max(abs(stepInLeafCells), vec3(1e-6));
+	vec3 rayPositiveAxes = vec3(greaterThanEqual(stepInLeafCells, vec3(0)));
+
+	// Indirection entry of the leaf cell the ray is in, only fetched when the ray enters a new cell
+	ivec3 cachedLeafCell = ivec3(-1);
+	int atlasTextureIndex = -1;
 	
     for(int i = 0; i < maxIterationCount; i++)
 	{
-		int atlasTextureIndex = texelFetch(nodeIndirectionSampler, nodeIndirectionBaseIndex + normalizedCoordToLinearOffset(pos)).r;
-		if (atlasTextureIndex != -1)
+		vec3 coordFloat = clamp(pos, 0.0, 0.9999) * leafCellCount;
+		ivec3 coordInt = ivec3(coordFloat);
+		vec3 frac = coordFloat - coordInt;
+
+		if (coordInt != cachedLeafCell)
+		{
+			cachedLeafCell = coordInt;
+			atlasTextureIndex = lookupLeafAtlasIndex(coordInt);
+		}
+
+		float stepMultiplier = (1.0 + stepDistanceGrowth * distanceFromCamera) * (lowDensity ? lowDensityStepMultiplier : 1.0);
+		float segmentLength = stepSize * stepMultiplier;
+
+		float advanceStepCount = 1.0;
+		if (atlasTextureIndex < 0)
+		{
+			// Empty leaf. Skip whole steps until the ray exits the leaf cell (3D DDA).
+			vec3 cellDistanceToExit = mix(frac, 1.0 - frac, rayPositiveAxes);
+			vec3 stepsToExit = cellDistanceToExit * stepsPerLeafCell / stepMultiplier;
+			advanceStepCount = max(1.0, ceil(min(stepsToExit.x, min(stepsToExit.y, stepsToExit.z))));
+		}
+		else
 		{
-			vec3 coordFloat = min(pos, 0.9999) * float(maxLeafCountPerInternalNodeDimension);
-			ivec3 coordInt = ivec3(coordFloat);
-			vec3 frac = coordFloat - coordInt;
-			
 			vec3 texCoordOffset = getLeafAtlasOffset(atlasTextureIndex);
 		
-			vec3 sampleTexCoord = clamp(frac, 0.5/8.0, 7.5/8.0) * texCoordScale + texCoordOffset;
+			vec3 sampleTexCoord = clamp(frac, halfVoxelInLeaf, 1.0 - halfVoxelInLeaf) * texCoordScale + texCoordOffset;
 		
-			vec4 albedoSample = textureGrad(albedoSampler, sampleTexCoord, vec3(0), vec3(0));
+			vec4 albedoSample = sampleAtlas(albedoSampler, sampleTexCoord);
 			float alpha = albedoSample.r;
 
-			if (alpha > thresholdAlpha)
+			lowDensity = (alpha <= thresholdAlpha);
+			if (!lowDensity)
 			{
 				alpha *= opacityMultiplier;
 			#ifdef USE_TEMPERATURE_SAMPLER
-				color = accumulateColorOverRaySegmentTemperatureMapped(color, sampleTexCoord, alpha, stepSize.x);
+				color = accumulateColorOverRaySegmentTemperatureMapped(color, sampleTexCoord, alpha, segmentLength);
 			#else
-				color = accumulateColorOverRaySegment(color, sampleTexCoord, alpha, stepSize.x);
+				color = accumulateColorOverRaySegment(color, sampleTexCoord, alpha, segmentLength);
 			#endif
 			}
 
@@ -152,7 +268,8 @@ void main()
 		}
      
         // Advance the current position
-        pos.xyz += step;
+        pos.xyz += step * (stepMultiplier * advanceStepCount);
+		distanceFromCamera += stepLength_modelSpace * stepMultiplier * advanceStepCount;
 	 
         // Break if the position is outside volume
         if(isNormalisedVolumeCoordOutsideVolume(pos))
@@ -23,11 +23,16 @@
 layout(location = 0) in vec4 vertexPosition_modelSpace;
 layout(location = 1) in vec3 vertexTexCoord;
 
+#ifdef USE_INSTANCED_BOXES
+// xyz is the box center relative to the model, w is the InternalNode index relative to firstInternalNodeIndex
+layout(location = 2) in vec4 instanceData;
+#endif
+
 out vec3 texCoord;
 out vec3 position_modelSpace;
 out flat int nodeIndirectionBaseIndex;
 
-uniform mat4 modelViewProj;
+#include "../Common/ObjectUniforms.h"
 uniform int firstInternalNodeIndex;
 uniform int maxLeafCountPerInternalNode;
 
@@ -35,11 +40,20 @@ const int verticesPerInternalNode = 8;
 
 void main()
 {
-	gl_Position = modelViewProj * vertexPosition_modelSpace;
+#ifdef USE_INSTANCED_BOXES
+	vec4 vertexPosition = vec4(vertexPosition_modelSpace.xyz + instanceData.xyz, 1.0);
+	int internalNodeIndex = firstInternalNodeIndex + int(instanceData.w);
+#else
+	vec4 vertexPosition = vertexPosition_modelSpace;
+	int internalNodeIndex = firstInternalNodeIndex + (gl_VertexID / verticesPerInternalNode);
+#endif
+
+	gl_Position = modelViewProj * vertexPosition;
 	texCoord = vertexTexCoord;
 	
-	int internalNodeIndex = firstInternalNodeIndex + (gl_VertexID / verticesPerInternalNode);
-	nodeIndirectionBaseIndex = internalNodeIndex * maxLeafCountPerInternalNode;
+	// Each InternalNode has a fixed size indirection header of occupancy mask words followed by entry offsets
+	int indirectionHeaderSize = 2 * ((maxLeafCountPerInternalNode + 31) / 32);
+	nodeIndirectionBaseIndex = internalNodeIndex * indirectionHeaderSize;
 	
-	position_modelSpace = vertexPosition_modelSpace.xyz;
+	position_modelSpace = vertexPosition.xyz;
 }
\ No newline at end of file
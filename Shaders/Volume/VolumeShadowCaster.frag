@@ -29,9 +29,8 @@ out vec4 color;
 
 uniform sampler3D albedoSampler;
 
-uniform float farClipDistance;
-uniform float maxClipSpaceDepth;
-uniform vec3 cameraForwardDirection_modelSpace;
+#include "../Common/FrameUniforms.h"
+#include "../Common/ObjectUniforms.h"
 
 uniform vec3 oneOnVolumeTextureSize;
 uniform vec3 volumeSize_modelSpace;
@@ -43,14 +43,11 @@ uniform sampler3D normalSampler;
 uniform sampler2D sceneDepthSampler;
 uniform sampler2D shadowSampler;
 
-uniform mat4 shadowModelViewProj;
+#include "../Common/FrameUniforms.h"
+#include "../Common/ObjectUniforms.h"
 
 uniform vec3 volumeSize_modelSpace;
-uniform vec3 cameraPosition_modelSpace;
-uniform vec3 lightDirection_modelSpace;
 uniform vec3 oneOnVolumeTextureSize;
-uniform float maxClipSpaceDepth;
-uniform vec2 viewportResolution;
 
 uniform float opacityMultiplier = 5.0f;
 
@@ -23,20 +23,23 @@
 #include "RenderableFactory.h"
 
 #include <GVis/VisSystem.h>
+#include <GVis/FrameProfiler.h>
 #include <GVis/Camera.h>
 #include <GVis/Viewport.h>
 #include <GVis/Window.h>
 #include <GVis/Math.h>
+#include <GCommon/CpuTimer.h>
+#include <GCommon/Logger.h>
 #include <GCommon/RollingMean.h>
 
 #include <boost/algorithm/string.hpp>
-#include <boost/date_time.hpp>
 #include <boost/program_options.hpp>
 #include <assert.h>
+#include <iomanip>
+#include <sstream>
 
 using namespace GCommon;
 using namespace GVis;
-using namespace boost::posix_time;
 using namespace boost;
 
 namespace GAppFramework {
@@ -66,7 +69,8 @@ Application::Application(const ApplicationConfig& config) :
 	m_elapsedTime(0),
 	m_simTimeStep(1.0f / 30.0f),
 	m_cameraInputEnabled(true),
-	m_meanTimeSinceLastUpdate(new RollingMean(40))
+	m_meanTimeSinceLastUpdate(new RollingMean(40)),
+	m_timeSinceProfileReport(0)
 {
 	m_visSystem.reset(new VisSystem);
 
@@ -99,25 +103,33 @@ void Application::run()
 
 	setupScene();
 
-	ptime previousTime = microsec_clock::local_time();
+	CpuTimer frameTimer;
 	float accumulatedSimTimeDebt = 0;
 	while(!m_window->isCloseRequested())
 	{
-		ptime currentTime = boost::posix_time::microsec_clock::local_time();
-		time_duration duration = currentTime - previousTime;
-		previousTime = currentTime;
-		float timeSinceLastUpdate = float(duration.total_milliseconds()) / 1000.0f;
+		float timeSinceLastUpdate = (float)frameTimer.getElapsedSeconds();
+		frameTimer.reset();
 		m_elapsedTime += timeSinceLastUpdate;
 		accumulatedSimTimeDebt += timeSinceLastUpdate;
 		accumulatedSimTimeDebt = std::min(1.0f / 15.0f, accumulatedSimTimeDebt); // maintain minimum frame rate
 
 		if (m_simTimeStep)
 		{
+			int stepCount = 0;
 			while (accumulatedSimTimeDebt > *m_simTimeStep)
 			{
 				accumulatedSimTimeDebt -= *m_simTimeStep;
+				++stepCount;
+			}
+
+			if (stepCount == 1)
+			{
 				simulate(*m_simTimeStep);
 			}
+			else if (stepCount > 1)
+			{
+				simulateSteps(*m_simTimeStep, stepCount);
+			}
 		}
 		else
 		{
@@ -130,6 +142,31 @@ void Application::run()
 
 		m_meanTimeSinceLastUpdate->addValue(timeSinceLastUpdate);
 		displayFramerate(m_meanTimeSinceLastUpdate->getMean());
+
+		if (m_profileReportInterval)
+		{
+			m_timeSinceProfileReport += timeSinceLastUpdate;
+			if (m_timeSinceProfileReport >= *m_profileReportInterval)
+			{
+				m_timeSinceProfileReport = 0;
+				logProfileReport();
+			}
+		}
+	}
+}
+
+void Application::setProfileReportInterval(boost::optional<float> interval)
+{
+	m_profileReportInterval = interval;
+	m_timeSinceProfileReport = 0;
+	m_visSystem->setProfilingEnabled(interval.is_initialized());
+}
+
+void Application::logProfileReport()
+{
+	if (FrameProfiler* profiler = m_visSystem->getProfiler())
+	{
+		defaultLogger()->logLine(profiler->createReport());
 	}
 }
 
@@ -144,6 +181,14 @@ CameraPtr Application::createCamera()
 	return camera;
 }
 
+void Application::simulateSteps(float dt, int stepCount)
+{
+	for (int i = 0; i < stepCount; ++i)
+	{
+		simulate(dt);
+	}
+}
+
 void Application::moveCamera(float dt)
 {
 	if (m_cameraController && m_cameraInputEnabled)
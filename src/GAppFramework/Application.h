@@ -57,10 +57,17 @@ public:
 	//! If no timeStep is set, simulation will update at frame rate
 	void setSimulationTimeStep(boost::optional<float> timeStep) {m_simTimeStep = timeStep;}
 
+	//! When set, enables VisSystem profiling and logs a per-pass timing report at this interval in seconds
+	void setProfileReportInterval(boost::optional<float> interval);
+
 protected:
 	virtual GVis::CameraPtr createCamera();
 	virtual void setupScene() = 0;
 	virtual void simulate(float dt) = 0;
+
+	//! Called with stepCount > 1 when the simulation needs to catch up by several fixed time steps in one frame.
+	//! Default implementation calls simulate() stepCount times. Override to batch the steps.
+	virtual void simulateSteps(float dt, int stepCount);
 	virtual void moveCamera(float dt);
 	virtual void render();
 
@@ -71,6 +78,7 @@ private:
 	void viewport_postRender();
 
 	void displayFramerate(double timeSinceLastFrame);
+	void logProfileReport();
 
 protected:
 	GVis::VisSystemPtr m_visSystem;
@@ -84,6 +92,9 @@ protected:
 	double m_elapsedTime;
 	boost::optional<float> m_simTimeStep;
 	boost::scoped_ptr<GCommon::RollingMean> m_meanTimeSinceLastUpdate;
+
+	boost::optional<float> m_profileReportInterval;
+	float m_timeSinceProfileReport;
 };
 
 } // namespace GAppFramework
@@ -26,6 +26,7 @@ namespace GCommon {
 
 using boost::shared_ptr;
 
+class CpuTimer;
 class FileFinder;
 class Listener;
 class Logger;
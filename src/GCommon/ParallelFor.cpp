@@ -0,0 +1,91 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ParallelFor.h"
+
+#include <boost/bind/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace GCommon {
+
+int getHardwareThreadCount()
+{
+	return std::max(1, (int)boost::thread::hardware_concurrency());
+}
+
+static void runInterleaved(int firstIndex, int stride, int count, const boost::function<void(int)>& function)
+{
+	for (int i = firstIndex; i < count; i += stride)
+	{
+		function(i);
+	}
+}
+
+//! Runs runInterleaved and captures any exception in exception so it can be rethrown on the calling thread
+static void runInterleavedCapturingException(int firstIndex, int stride, int count, const boost::function<void(int)>& function, boost::exception_ptr& exception)
+{
+	try
+	{
+		runInterleaved(firstIndex, stride, count, function);
+	}
+	catch (...)
+	{
+		exception = boost::current_exception();
+	}
+}
+
+void parallelFor(int count, int threadCount, const boost::function<void(int)>& function)
+{
+	if (threadCount <= 0)
+	{
+		threadCount = getHardwareThreadCount();
+	}
+	threadCount = std::min(threadCount, count);
+
+	if (threadCount <= 1)
+	{
+		runInterleaved(0, 1, count, function);
+		return;
+	}
+
+	// Calling thread does its share of the work too. Every thread is joined before returning or rethrowing,
+	// since workers reference function and the exceptions vector.
+	std::vector<boost::exception_ptr> exceptions(threadCount);
+	boost::thread_group threads;
+	for (int i = 1; i < threadCount; ++i)
+	{
+		threads.create_thread(boost::bind(&runInterleavedCapturingException, i, threadCount, count, boost::cref(function), boost::ref(exceptions[i])));
+	}
+	runInterleavedCapturingException(0, threadCount, count, function, exceptions[0]);
+	threads.join_all();
+
+	for (int i = 0; i < threadCount; ++i)
+	{
+		if (exceptions[i])
+		{
+			boost::rethrow_exception(exceptions[i]);
+		}
+	}
+}
+
+} // namespace GCommon
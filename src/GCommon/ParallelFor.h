@@ -0,0 +1,39 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <boost/function.hpp>
+
+namespace GCommon {
+
+//! @return number of hardware threads, or 1 if unknown
+extern int getHardwareThreadCount();
+
+/*! Calls function(i) for each i in [0, count) using threadCount threads.
+	Indices are interleaved across threads, so jobs of similar cost are evenly balanced.
+	If threadCount <= 0, the hardware thread count is used. If threadCount is 1, function is called on the calling thread.
+	Threads are created for each call and joined before returning. No pool is kept, because callers run a few large batches
+	(e.g. one per texture atlas) where thread creation is negligible next to the work. Prefer one call over many small ones.
+	If function throws, the thread that threw stops taking indices, all threads are joined and the exception is rethrown on the calling thread (the first in thread order if several threw).
+*/
+extern void parallelFor(int count, int threadCount, const boost::function<void(int)>& function);
+
+} // namespace GCommon
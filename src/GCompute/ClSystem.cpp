@@ -55,8 +55,16 @@ ClSystem::~ClSystem()
 {
 }
 
-void ClSystem::loadProgram(cl::Program& program, const std::string &filename) const
+void ClSystem::loadProgram(cl::Program& program, const std::string &filename, const std::string& buildOptions) const
 {
+	std::string cacheKey = filename + "|" + buildOptions;
+	ProgramCache::const_iterator i = m_programCache.find(cacheKey);
+	if (i != m_programCache.end())
+	{
+		program = *i->second;
+		return;
+	}
+
 	cl_int err;
 
     defaultLogger()->logLine("Loading and compiling CL source");
@@ -76,7 +84,13 @@ void ClSystem::loadProgram(cl::Program& program, const std::string &filename) co
 
 	std::string includePath = boost::filesystem::path(filename).parent_path().string();
 
-	err = program.build(m_devices, std::string("-I " + includePath).c_str());
+	std::string options = "-I " + includePath;
+	if (!buildOptions.empty())
+	{
+		options += " " + buildOptions;
+	}
+
+	err = program.build(m_devices, options.c_str());
     if (err != CL_SUCCESS) {
 
         if(err == CL_BUILD_PROGRAM_FAILURE)
@@ -93,6 +107,8 @@ void ClSystem::loadProgram(cl::Program& program, const std::string &filename) co
     }
 
 	defaultLogger()->logLine("Compilation successful");
+
+	m_programCache[cacheKey] = ProgramPtr(new cl::Program(program));
 }
 
 cl::Context& ClSystem::_getContext() const
@@ -22,6 +22,8 @@
 
 #include "GComputeFwd.h"
 #include <boost/scoped_ptr.hpp>
+#include <map>
+#include <string>
 #include <vector>
 
 namespace GCompute {
@@ -33,7 +35,10 @@ public:
 	ClSystem();
 	~ClSystem();
 
-	void loadProgram(cl::Program& program, const std::string &filename) const;
+	//! Loads and builds a program. Programs are cached by filename and build options, so loading the same
+	//! program variant more than once only compiles it once.
+	//! @param buildOptions are appended to the compiler options, e.g "-D GRID_WIDTH=64"
+	void loadProgram(cl::Program& program, const std::string &filename, const std::string& buildOptions = "") const;
 
 	void writeToDevice(const cl::Buffer& buffer, const void* data, int sizeBytes);
 	void readFromDevice(void* data, const cl::Buffer& buffer, int sizeBytes);
@@ -51,6 +56,9 @@ private:
 	ContextPtr m_context;
 	std::vector<cl::Device> m_devices;
 	boost::scoped_ptr<cl::CommandQueue> m_queue;
+
+	typedef std::map<std::string, ProgramPtr> ProgramCache;
+	mutable ProgramCache m_programCache;
 };
 
 extern void checkError(int status, const std::string& contextMessage="");
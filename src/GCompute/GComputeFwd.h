@@ -42,5 +42,6 @@ struct GlTexture;
 
 typedef shared_ptr<ClSystem> ClSystemPtr;
 typedef shared_ptr<cl::Context> ContextPtr;
+typedef shared_ptr<cl::Program> ProgramPtr;
 
 } // namespace GCompute
@@ -28,6 +28,7 @@
 #include <GCompute/ClIncludes.h>
 #include <GCompute/GlTexture.h>
 
+#include <boost/lexical_cast.hpp>
 #include <boost/scoped_array.hpp>
 
 #ifdef __APPLE__
@@ -70,6 +71,17 @@ static cl_float2 toClFloat2(const Float3& position)
 	return result;
 }
 
+//! @return build options which specialize the fluid kernels for a fixed grid size.
+//! Grids with a depth of 1 are built as 2D kernels.
+static std::string createGridBuildOptions(int width, int height, int depth)
+{
+	using boost::lexical_cast;
+	return "-D GRID_WIDTH=" + lexical_cast<std::string>(width)
+		+ " -D GRID_HEIGHT=" + lexical_cast<std::string>(height)
+		+ " -D GRID_DEPTH=" + lexical_cast<std::string>(depth)
+		+ " -D DIMENSIONS=" + (depth > 1 ? "3" : "2");
+}
+
 class FluidSolverI : public FluidSolver
 {
 public:
@@ -114,7 +126,8 @@ public:
 
 
 		// Load kernels
-		system.loadProgram(m_program, fluidKernalsDir + "/FluidDynamics.cl");
+		std::string buildOptions = createGridBuildOptions(m_width, m_height, m_depth);
+		system.loadProgram(m_program, fluidKernalsDir + "/FluidDynamics.cl", buildOptions);
 
 		ClSystem::createKernel(m_kernel_applyForces, m_program, "applyForces");
 		ClSystem::createKernel(m_kernel_coolFluid, m_program, "coolFluid");
@@ -146,10 +159,10 @@ public:
 
 		m_divergenceFreeProjector.reset(new DivergenceFreeProjector(m_kernelRunner, m_program, &tempBuffer));
 
-		system.loadProgram(m_advectFloat3Pogram, fluidKernalsDir + "/AdvectionFloat3.cl");
+		system.loadProgram(m_advectFloat3Pogram, fluidKernalsDir + "/AdvectionFloat3.cl", buildOptions);
 		m_float3Advecter = createAdvecter(m_kernelRunner, m_advectFloat3Pogram, &tempBuffer);
 
-		system.loadProgram(m_advectFluidStatePogram, fluidKernalsDir + "/AdvectionFluidState.cl");
+		system.loadProgram(m_advectFluidStatePogram, fluidKernalsDir + "/AdvectionFluidState.cl", buildOptions);
 		m_fluidStateAdvecter = createAdvecter(m_kernelRunner, m_advectFluidStatePogram, &tempBuffer);
 
 
@@ -179,11 +192,24 @@ public:
 		m_paramsBuffer = cl::Buffer(system._getContext(), CL_MEM_READ_ONLY, sizeof(Params), NULL, &err);
 	}
 
-	void update(float dt)
+	cl::Event update(float dt, int substeps, const SubstepCallback& beforeSubstep)
 	{
+		assert(substeps > 0);
 		uploadParams();
-		simulateFluid(dt);
-		visFluid();
+
+		// Enqueue all substeps without waiting. Input and output buffers are swapped on the host as each
+		// substep is enqueued, so each kernel captures the buffers for its substep in its arguments.
+		ScopedKernelRunnerBlocking nonBlocking(*m_kernelRunner, false);
+		for (int i = 0; i < substeps; ++i)
+		{
+			if (beforeSubstep)
+			{
+				beforeSubstep();
+			}
+			simulateFluid(dt);
+		}
+
+		return visFluid();
 	}
 
 	void setFluid(const Float3& position, float density, float temperature)
@@ -266,17 +292,13 @@ private:
 		std::swap(m_fluidStateGridInputPtr, m_fluidStateGridOutputPtr);
 	}
 
-	void visFluid()
+	cl::Event visFluid()
 	{
-		cl::Event evt;
-
 		std::vector<cl::Memory> memObjs;
 		memObjs.push_back(m_fluidStateImageBuffer);
 
 		glFinish();
-		m_queue.enqueueAcquireGLObjects(&memObjs, 0, &evt);
-		checkError(m_queue.flush());
-		waitForComplete(evt);
+		checkError(m_queue.enqueueAcquireGLObjects(&memObjs));
 
 		if (true)
 		{
@@ -292,11 +314,10 @@ private:
 			m_kernelRunner->run(m_kernel_visVelocity);
 		}
 
-		m_queue.enqueueReleaseGLObjects(&memObjs, 0, &evt);
+		cl::Event evt;
+		checkError(m_queue.enqueueReleaseGLObjects(&memObjs, 0, &evt));
 		checkError(m_queue.flush());
-		waitForComplete(evt);
-
-		m_queue.finish();
+		return evt;
 	}
 
 	void uploadParams()
@@ -375,6 +396,11 @@ FluidSolver::FluidSolver() :
 {
 }
 
+void FluidSolver::update(float dt)
+{
+	waitForComplete(update(dt, 1));
+}
+
 FluidSolverPtr createFluidSolver(ClSystem& system, const GlTexture& fluidStateTexture, const TempBufferPoolPtr& tempBufferPool, const std::string& fluidKernalsDir)
 {
 	return FluidSolverPtr(new FluidSolverI(system, fluidStateTexture, tempBufferPool, fluidKernalsDir));
@@ -25,6 +25,7 @@
 
 #include <GCompute/GComputeFwd.h>
 
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 
@@ -63,7 +64,18 @@ class FluidSolver : public BufferProvider
 public:
 	virtual ~FluidSolver() {};
 
-	virtual void update(float dt) = 0;
+	//! Runs one simulation step and waits for it to complete
+	void update(float dt);
+
+	typedef boost::function<void()> SubstepCallback;
+
+	/*! Enqueues substeps simulation steps of dt each, followed by writing to the output texture.
+		No host synchronization takes place between substeps.
+		@param beforeSubstep is called before each substep is enqueued, e.g. to inject fluid every step. Can be empty.
+		Solver calls made from it are enqueued without waiting, in order with the substeps.
+		@return event which completes when the output texture has been written and released back to GL
+	*/
+	virtual cl::Event update(float dt, int substeps, const SubstepCallback& beforeSubstep = SubstepCallback()) = 0;
 
 	virtual void setFluid(const Float3& position, float density, float temperature) = 0;
 	virtual void addFluid(const Float3& position, float density, float temperature) = 0;
@@ -26,7 +26,8 @@ namespace GFluid {
 KernelRunner::KernelRunner(cl::CommandQueue queue, cl::NDRange globalThreads, cl::NDRange localThreads) :
 	m_queue(queue),
 	m_globalThreads(globalThreads),
-	m_localThreads(localThreads)
+	m_localThreads(localThreads),
+	m_blocking(true)
 {
 }
 
@@ -35,8 +36,11 @@ void KernelRunner::run(cl::Kernel& kernel)
 	// run the kernel
 	cl::Event evt;
 	GCompute::checkError(m_queue.enqueueNDRangeKernel(kernel, cl::NullRange, m_globalThreads, m_localThreads, NULL, &evt));
-	GCompute::checkError(m_queue.flush());
-	GCompute::waitForComplete(evt);
+	if (m_blocking)
+	{
+		GCompute::checkError(m_queue.flush());
+		GCompute::waitForComplete(evt);
+	}
 }
 
 } // namespace GFluid
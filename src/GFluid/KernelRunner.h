@@ -29,12 +29,44 @@ class KernelRunner
 public:
 	KernelRunner(cl::CommandQueue queue, cl::NDRange globalThreads, cl::NDRange localThreads);
 
+	//! Enqueues the kernel. If blocking, also waits for the kernel to complete.
 	void run(cl::Kernel& kernel);
 
+	//! When not blocking, kernels are only enqueued and the caller is responsible for
+	//! waiting on the queue. Kernel arguments are captured at enqueue time, so kernels can be
+	//! re-enqueued with different arguments before earlier ones complete. Default is blocking.
+	void setBlocking(bool blocking) {m_blocking = blocking;}
+	bool isBlocking() const {return m_blocking;}
+
 private:
 	cl::CommandQueue m_queue;
 	cl::NDRange m_globalThreads;
 	cl::NDRange m_localThreads;
+	bool m_blocking;
+};
+
+//! Sets the blocking mode of a KernelRunner for the enclosing scope, restoring the previous mode on exit
+class ScopedKernelRunnerBlocking
+{
+public:
+	ScopedKernelRunnerBlocking(KernelRunner& runner, bool blocking) :
+		m_runner(runner),
+		m_previousBlocking(runner.isBlocking())
+	{
+		m_runner.setBlocking(blocking);
+	}
+
+	~ScopedKernelRunnerBlocking()
+	{
+		m_runner.setBlocking(m_previousBlocking);
+	}
+
+private:
+	ScopedKernelRunnerBlocking(const ScopedKernelRunnerBlocking&);
+	ScopedKernelRunnerBlocking& operator=(const ScopedKernelRunnerBlocking&);
+
+	KernelRunner& m_runner;
+	bool m_previousBlocking;
 };
 
 } // namespace GFluid
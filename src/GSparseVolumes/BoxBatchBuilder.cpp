@@ -70,6 +70,19 @@ void BoxBatchBuilder::addBox(const glm::vec3& centerPosition, const glm::vec3& s
 	m_uvs.push_back(glm::vec3(0.0f, 1.0f, 1.0f));
 }
 
+void BoxBatchBuilder::getBounds(glm::vec3& minPosition, glm::vec3& maxPosition) const
+{
+	assert(!m_positions.empty());
+	minPosition = m_positions.front();
+	maxPosition = m_positions.front();
+
+	for (size_t i = 1; i < m_positions.size(); ++i)
+	{
+		minPosition = glm::min(minPosition, m_positions[i]);
+		maxPosition = glm::max(maxPosition, m_positions[i]);
+	}
+}
+
 // Returns null if mesh is empty
 MeshPtr BoxBatchBuilder::build(BufferUsage usage) const
 {
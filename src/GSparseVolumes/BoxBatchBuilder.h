@@ -38,6 +38,9 @@ public:
 
 	const std::vector<GLint>& getIndices() const {return m_indices;}
 
+	//! Outputs the axis aligned bounds of all boxes. Must not be called when empty.
+	void getBounds(glm::vec3& minPosition, glm::vec3& maxPosition) const;
+
 private:
 	std::vector<glm::vec3> m_positions;
 	std::vector<glm::vec3> m_uvs;
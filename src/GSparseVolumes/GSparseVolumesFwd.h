@@ -30,8 +30,10 @@ using boost::shared_ptr;
 class InternalNode;
 class InternalNodeIterator;
 class Grid;
+struct GridTopology;
 class Leaf;
 class LeafIterator;
+class NodeIndirectionMap;
 struct RenderableVolume;
 
 typedef shared_ptr<InternalNode> InternalNodePtr;
@@ -54,6 +54,9 @@ public:
 	virtual size_t getInternalNodeCount() const = 0;
 	virtual InternalNodeIteratorPtr createInternalNodeIterator() const = 0;
 	virtual int getChannelCount() const = 0;
+
+	//! Fills an empty topology with all InternalNodes and leaves, in createInternalNodeIterator() order
+	virtual void buildTopology(GridTopology& topology) const = 0;
 };
 
 } // namespace GSparseVolumes
\ No newline at end of file
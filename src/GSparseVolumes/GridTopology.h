@@ -0,0 +1,72 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <GVis/Math.h>
+
+#include <vector>
+
+namespace GSparseVolumes {
+
+/*!
+Flat snapshot of the structure of a Grid, built in a single traversal by Grid::buildTopology().
+Leaves of InternalNode i are at [leafOffsets[i], leafOffsets[i + 1]) in leafIndicesInInternalNode,
+in the same order as the InternalNode's LeafIterator returns them.
+*/
+struct GridTopology
+{
+	GridTopology() :
+		internalNodeSize(0,0,0)
+	{
+		leafOffsets.push_back(0);
+	}
+
+	int getInternalNodeCount() const {return (int)internalNodeCenters.size();}
+	int getLeafCount() const {return (int)leafIndicesInInternalNode.size();}
+	int getLeafCount(int internalNodeIndex) const {return leafOffsets[internalNodeIndex + 1] - leafOffsets[internalNodeIndex];}
+
+	//! Appends an InternalNode. Its leaves must be added next with addLeaf().
+	void addInternalNode(const glm::vec3& center)
+	{
+		internalNodeCenters.push_back(center);
+		leafOffsets.push_back(leafOffsets.back());
+	}
+
+	//! Adds a leaf to the last InternalNode
+	void addLeaf(int indexInInternalNode)
+	{
+		leafIndicesInInternalNode.push_back(indexInInternalNode);
+		++leafOffsets.back();
+	}
+
+	//! Bounding box size shared by all InternalNodes
+	glm::vec3 internalNodeSize;
+
+	std::vector<glm::vec3> internalNodeCenters;
+
+	//! Has one more element than there are InternalNodes
+	std::vector<int> leafOffsets;
+
+	//! Leaf::getIndexInInternalNode() of each leaf
+	std::vector<int> leafIndicesInInternalNode;
+};
+
+} // namespace GSparseVolumes
@@ -60,5 +60,7 @@ private:
 };
 
 typedef ImageBuffer<unsigned char> ImageBufferUChar;
+typedef ImageBuffer<unsigned short> ImageBufferUShort;
+typedef ImageBuffer<float> ImageBufferFloat;
 
 } // namespace GSparseVolumes
@@ -37,7 +37,11 @@ public:
 
 	virtual int getVoxelCountPerDimension() const = 0;
 
+	//! Writes values quantized to [0, 255]
 	virtual void toImageBuffer(ImageBufferUChar& buffer, const glm::ivec3& fillOffset) const = 0;
+
+	//! Writes values at full precision. Integer values are normalized to [0, 1].
+	virtual void toImageBuffer(ImageBufferFloat& buffer, const glm::ivec3& fillOffset) const = 0;
 };
 
 } // namespace GSparseVolumes
\ No newline at end of file
@@ -0,0 +1,92 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "NodeIndirectionMap.h"
+#include "GridTopology.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <boost/cstdint.hpp>
+
+namespace GSparseVolumes {
+
+static const int bitsPerWord = 32;
+
+static int countBits(boost::uint32_t v)
+{
+	v = v - ((v >> 1) & 0x55555555u);
+	v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+	return (int)((((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+}
+
+NodeIndirectionMap::NodeIndirectionMap(const GridTopology& topology, int maxLeafCountPerInternalNode) :
+	m_wordCount((maxLeafCountPerInternalNode + bitsPerWord - 1) / bitsPerWord)
+{
+	int internalNodeCount = topology.getInternalNodeCount();
+	int headerSize = getHeaderSize(maxLeafCountPerInternalNode);
+	int entriesBegin = internalNodeCount * headerSize;
+	m_data.resize(entriesBegin + topology.getLeafCount(), -1);
+
+	m_firstEntryIndices.push_back(entriesBegin);
+
+	std::vector<boost::uint32_t> mask(m_wordCount);
+	for (int n = 0; n < internalNodeCount; ++n)
+	{
+		// Set occupancy bits
+		std::fill(mask.begin(), mask.end(), 0);
+		for (int i = topology.leafOffsets[n]; i < topology.leafOffsets[n + 1]; ++i)
+		{
+			int leafIndex = topology.leafIndicesInInternalNode[i];
+			assert(leafIndex < maxLeafCountPerInternalNode);
+			mask[leafIndex / bitsPerWord] |= 1u << (leafIndex % bitsPerWord);
+		}
+
+		// Write mask and prefix sums of the mask into the header
+		int* header = &m_data[n * headerSize];
+		int entryIndex = m_firstEntryIndices.back();
+		for (int w = 0; w < m_wordCount; ++w)
+		{
+			header[w] = (int)mask[w];
+			header[m_wordCount + w] = entryIndex;
+			entryIndex += countBits(mask[w]);
+		}
+
+		assert(entryIndex - m_firstEntryIndices.back() == topology.getLeafCount(n));
+		m_firstEntryIndices.push_back(entryIndex);
+	}
+}
+
+int NodeIndirectionMap::getHeaderSize(int maxLeafCountPerInternalNode)
+{
+	return 2 * ((maxLeafCountPerInternalNode + bitsPerWord - 1) / bitsPerWord);
+}
+
+int NodeIndirectionMap::getEntryIndex(int internalNodeIndex, int leafIndexInInternalNode) const
+{
+	const int* header = &m_data[internalNodeIndex * 2 * m_wordCount];
+	int word = leafIndexInInternalNode / bitsPerWord;
+	boost::uint32_t bit = 1u << (leafIndexInInternalNode % bitsPerWord);
+	boost::uint32_t mask = (boost::uint32_t)header[word];
+	assert(mask & bit);
+
+	return header[m_wordCount + word] + countBits(mask & (bit - 1));
+}
+
+} // namespace GSparseVolumes
@@ -0,0 +1,68 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "GSparseVolumesFwd.h"
+
+#include <vector>
+
+namespace GSparseVolumes {
+
+/*!
+Maps {internalNodeIndex, leafIndexInInternalNode} to the atlas slot of a leaf, storing entries only for leaves which exist.
+The map is uploaded as an R32I texture buffer laid out as:
+ - A fixed size header per InternalNode, at internalNodeIndex * getHeaderSize(). The header holds wordCount occupancy
+   mask words followed by wordCount entry offsets, where wordCount = ceil(maxLeafCountPerInternalNode / 32).
+   Entry offset w is the buffer index of the entry of the first existing leaf covered by mask word w.
+ - One entry per existing leaf after all headers, in InternalNode then leaf index order. Entries are -1 for leaves with no slot.
+The entry of leaf i is at entryOffset[i / 32] + popcount(mask[i / 32] & ((1 << (i % 32)) - 1)), and leaves whose mask
+bit is clear have no slot. This costs 2 bits per possible leaf plus 4 bytes per existing leaf, instead of 4 bytes per possible leaf.
+*/
+class NodeIndirectionMap
+{
+public:
+	//! All entries are initialized to -1
+	NodeIndirectionMap(const GridTopology& topology, int maxLeafCountPerInternalNode);
+
+	static int getHeaderSize(int maxLeafCountPerInternalNode);
+
+	//! @return index in getData() of a leaf's entry. The leaf must exist in the topology.
+	int getEntryIndex(int internalNodeIndex, int leafIndexInInternalNode) const;
+
+	void setLeafSlot(int internalNodeIndex, int leafIndexInInternalNode, int slot)
+	{
+		m_data[getEntryIndex(internalNodeIndex, leafIndexInInternalNode)] = slot;
+	}
+
+	//! Entries of an InternalNode's leaves are contiguous, starting at getFirstEntryIndex(internalNodeIndex)
+	int getFirstEntryIndex(int internalNodeIndex) const {return m_firstEntryIndices[internalNodeIndex];}
+	int getEntryCount(int internalNodeIndex) const {return m_firstEntryIndices[internalNodeIndex + 1] - m_firstEntryIndices[internalNodeIndex];}
+
+	const std::vector<int>& getData() const {return m_data;}
+	std::vector<int>& getData() {return m_data;}
+
+private:
+	int m_wordCount;
+	std::vector<int> m_firstEntryIndices; //!< Has one more element than there are InternalNodes
+	std::vector<int> m_data;
+};
+
+} // namespace GSparseVolumes
@@ -0,0 +1,336 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "PagedRenderableVolume.h"
+#include "BoxBatchBuilder.h"
+#include "Grid.h"
+#include "GridTopology.h"
+#include "GridVectorIterators.h"
+#include "InternalNode.h"
+#include "Leaf.h"
+#include "NodeIndirectionMap.h"
+#include "VolumeTextureAtlasBuilder.h"
+
+#include <GVis/Camera.h>
+#include <GVis/Frustum.h>
+#include <GVis/Geo.h>
+#include <GVis/PixelUnpackBuffer.h>
+#include <GVis/RenderableNode.h>
+#include <GVis/Texture.h>
+#include <GVis/TextureBufferObject.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace GVis;
+
+namespace GSparseVolumes {
+
+PagedRenderableVolume::PagedRenderableVolume(const RenderableVolumeConfig& config, const PagedVolumeConfig& pagedConfig) :
+	m_grids(config.grids),
+	m_cacheLeafCount(pagedConfig.cacheLeafCount),
+	m_maxInternalNodeLoadsPerUpdate(pagedConfig.maxInternalNodeLoadsPerUpdate)
+{
+	assert(!m_grids.empty());
+	assert(m_cacheLeafCount > 0);
+
+	const Grid& firstGrid = *m_grids.front();
+	m_leafWidth = firstGrid.getVoxelCountPerLeafDimension();
+
+	GridTopology topology;
+	firstGrid.buildTopology(topology);
+	m_indirectionMap.reset(new NodeIndirectionMap(topology, (int)firstGrid.getMaxLeafCountPerInternalNode()));
+
+	// Gather InternalNodes and their leaf counts
+	InternalNodesIterator internalNodesIterator(m_grids);
+	while (const InternalNodes* internalNodes = internalNodesIterator.next())
+	{
+		PagedInternalNode node;
+		node.internalNodes = *internalNodes;
+		node.resident = false;
+		node.leafCount = topology.getLeafCount((int)m_internalNodes.size());
+
+		if (node.leafCount > m_cacheLeafCount)
+		{
+			throw std::runtime_error("Too many leaves in InternalNode to fit in brick cache");
+		}
+		m_internalNodes.push_back(node);
+	}
+
+	if (m_internalNodes.empty())
+	{
+		return;
+	}
+
+	// Create empty cache atlases
+	for (int i = 0; i < m_grids.size(); ++i)
+	{
+		VolumeTextureAtlasBuilder atlasBuilder(m_cacheLeafCount, m_grids[i]->getVoxelCountPerLeafDimension(), m_grids[i]->getChannelCount(), AtlasPackingMode_Tight);
+		m_atlases.push_back(atlasBuilder.build());
+		m_maxLeafCountPerAtlasDimension = atlasBuilder.getMaxItemCountPerDimension();
+		m_stagingBuffers.push_back(PixelUnpackBufferPtr(new PixelUnpackBuffer));
+	}
+
+	// Slots are handed out from the back, lowest slot first
+	for (int slot = m_cacheLeafCount - 1; slot >= 0; --slot)
+	{
+		m_freeSlots.push_back(slot);
+	}
+
+	// Create indirection texture with no leaves resident
+	TexturePtr nodeIndirectionTexture;
+	{
+		std::vector<int>& data = m_indirectionMap->getData();
+		m_indirectionBuffer.reset(new ScopedTextureBufferObject(&data[0], data.size(), sizeof(int), BufferUsage_Dynamic));
+		nodeIndirectionTexture.reset(new Texture(BufferTextureConfig(PixelFormat_R32I, m_indirectionBuffer)));
+	}
+
+	GridTexturesMap textures;
+	for (int i = 0; i < m_grids.size(); ++i)
+	{
+		textures[m_grids[i]] = m_atlases[i];
+	}
+
+	// Create one box per InternalNode. All boxes are the same size, so they share a mesh.
+	m_boxSize = m_internalNodes.front().internalNodes.front()->getBoundingBoxSize() * config.scale;
+	BoxBatchBuilder boxBuilder;
+	boxBuilder.addBox(glm::vec3(0,0,0), m_boxSize);
+	MeshPtr boxMesh = boxBuilder.build();
+
+	for (int i = 0; i < m_internalNodes.size(); ++i)
+	{
+		const InternalNodePtr& internalNode = m_internalNodes[i].internalNodes.front();
+		assert(internalNode->getBoundingBoxSize() * config.scale == m_boxSize);
+
+		SparseVolumeMaterialConfig materialConfig;
+		materialConfig.boxSize = m_boxSize;
+		materialConfig.leafAtlases = textures;
+		materialConfig.nodeIndirectionTexture = nodeIndirectionTexture;
+		materialConfig.firstInternalNodeIndex = i;
+		materialConfig.maxLeafCountPerInternalNodeDimension = firstGrid.getMaxLeafCountPerInternalNodeDimension();
+		materialConfig.maxLeafCountPerAtlasDimension = m_maxLeafCountPerAtlasDimension;
+		materialConfig.leafVoxelCountPerDimension = m_leafWidth;
+
+		MaterialPtr material = config.materialFactory->createMaterial(materialConfig);
+
+		RenderableNodePtr node(new RenderableNode);
+		node->addRenderable(GeoPtr(new Geo(boxMesh, material)));
+		node->setPosition(internalNode->getBoundingBoxCenter() * config.scale + config.offset);
+		node->setLocalBounds(BoundingBox::fromCenterAndHalfSize(glm::vec3(0,0,0), m_boxSize * 0.5f));
+		node->setVisible(false);
+		m_renderableNodes.push_back(node);
+	}
+}
+
+PagedRenderableVolume::~PagedRenderableVolume()
+{
+}
+
+void PagedRenderableVolume::update(const Camera& camera)
+{
+	Frustum frustum(camera.getViewProjectionMatrix());
+	glm::vec3 cameraPosition = camera.getPosition();
+	glm::vec3 halfBoxSize = m_boxSize * 0.5f;
+
+	// Find visible InternalNodes, nearest first
+	std::vector<std::pair<float, int> > visibleNodes;
+	for (int i = 0; i < m_internalNodes.size(); ++i)
+	{
+		glm::vec3 center = m_renderableNodes[i]->getPosition();
+		if (!frustum.isOutside(BoundingBox::fromCenterAndHalfSize(center, halfBoxSize)))
+		{
+			visibleNodes.push_back(std::make_pair(glm::length(center - cameraPosition), i));
+		}
+	}
+	std::sort(visibleNodes.begin(), visibleNodes.end());
+
+	// Mark resident visible nodes as most recently used. Iterate farthest first so the nearest end up at the front.
+	for (int i = (int)visibleNodes.size() - 1; i >= 0; --i)
+	{
+		PagedInternalNode& node = m_internalNodes[visibleNodes[i].second];
+		if (node.resident)
+		{
+			m_lru.splice(m_lru.begin(), m_lru, node.lruPosition);
+		}
+	}
+	int visibleResidentCount = 0;
+	for (int i = 0; i < visibleNodes.size(); ++i)
+	{
+		visibleResidentCount += m_internalNodes[visibleNodes[i].second].resident ? 1 : 0;
+	}
+
+	// Allocate slots for visible nodes which are not resident, evicting nodes which are not visible
+	std::vector<int> nodesToLoad;
+	for (int i = 0; i < visibleNodes.size() && nodesToLoad.size() < m_maxInternalNodeLoadsPerUpdate; ++i)
+	{
+		int index = visibleNodes[i].second;
+		PagedInternalNode& node = m_internalNodes[index];
+		if (node.resident)
+		{
+			continue;
+		}
+
+		// Nodes past the first visibleResidentCount in the LRU list were not visible this update
+		while (m_freeSlots.size() < node.leafCount && m_lru.size() > visibleResidentCount)
+		{
+			evict(m_lru.back());
+		}
+
+		if (m_freeSlots.size() < node.leafCount)
+		{
+			break; // cache is full of visible nodes
+		}
+
+		for (int j = 0; j < node.leafCount; ++j)
+		{
+			node.slots.push_back(m_freeSlots.back());
+			m_freeSlots.pop_back();
+		}
+		node.resident = true;
+		m_lru.push_front(index);
+		node.lruPosition = m_lru.begin();
+		++visibleResidentCount;
+		nodesToLoad.push_back(index);
+	}
+
+	if (!nodesToLoad.empty())
+	{
+		load(nodesToLoad);
+	}
+}
+
+void PagedRenderableVolume::load(const std::vector<int>& internalNodeIndices)
+{
+	int leafCount = 0;
+	for (int i = 0; i < internalNodeIndices.size(); ++i)
+	{
+		leafCount += m_internalNodes[internalNodeIndices[i]].leafCount;
+	}
+
+	// Map one staging buffer per grid with room for every brick in this batch
+	std::vector<shared_ptr<ImageBufferUChar> > leafBuffers;
+	std::vector<size_t> brickSizesBytes;
+	std::vector<unsigned char*> stagingData;
+	for (int i = 0; i < m_grids.size(); ++i)
+	{
+		leafBuffers.push_back(shared_ptr<ImageBufferUChar>(new ImageBufferUChar(m_leafWidth, m_leafWidth, m_leafWidth, m_grids[i]->getChannelCount())));
+		brickSizesBytes.push_back(leafBuffers.back()->getSizeInBytes());
+		void* data = (leafCount > 0) ? m_stagingBuffers[i]->map(leafCount * brickSizesBytes.back()) : 0;
+		stagingData.push_back(static_cast<unsigned char*>(data));
+	}
+
+	// Write bricks to staging buffers. If a staging buffer could not be mapped, upload that grid's bricks directly.
+	int brickIndex = 0;
+	for (int n = 0; n < internalNodeIndices.size(); ++n)
+	{
+		int internalNodeIndex = internalNodeIndices[n];
+		const PagedInternalNode& node = m_internalNodes[internalNodeIndex];
+		assert(node.resident && node.slots.size() == node.leafCount);
+
+		int leafIndex = 0;
+		LeavesIterator leavesIterator(node.internalNodes);
+		while (const Leaves* leaves = leavesIterator.next())
+		{
+			int slot = node.slots[leafIndex];
+			for (int i = 0; i < leaves->size(); ++i)
+			{
+				ImageBufferUChar& buffer = *leafBuffers[i];
+				(*leaves)[i]->toImageBuffer(buffer, glm::ivec3(0,0,0));
+				if (stagingData[i])
+				{
+					memcpy(stagingData[i] + brickIndex * brickSizesBytes[i], buffer.data, brickSizesBytes[i]);
+				}
+				else
+				{
+					glm::ivec3 offset = getSlotOffset(slot);
+					m_atlases[i]->setSubImage(offset.x, offset.y, offset.z, m_leafWidth, m_leafWidth, m_leafWidth, buffer.data);
+				}
+			}
+
+			m_indirectionMap->setLeafSlot(internalNodeIndex, leaves->front()->getIndexInInternalNode(), slot);
+			++leafIndex;
+			++brickIndex;
+		}
+		assert(leafIndex == node.leafCount);
+	}
+	assert(brickIndex == leafCount);
+
+	for (int i = 0; i < m_grids.size(); ++i)
+	{
+		m_stagingBuffers[i]->unmap();
+	}
+
+	// Copy staged bricks into the atlases
+	brickIndex = 0;
+	for (int n = 0; n < internalNodeIndices.size(); ++n)
+	{
+		const PagedInternalNode& node = m_internalNodes[internalNodeIndices[n]];
+		for (int j = 0; j < node.leafCount; ++j)
+		{
+			glm::ivec3 offset = getSlotOffset(node.slots[j]);
+			for (int i = 0; i < m_grids.size(); ++i)
+			{
+				if (stagingData[i])
+				{
+					m_atlases[i]->setSubImage(offset.x, offset.y, offset.z, m_leafWidth, m_leafWidth, m_leafWidth, *m_stagingBuffers[i], brickIndex * brickSizesBytes[i]);
+				}
+			}
+			++brickIndex;
+		}
+
+		uploadIndirectionEntries(internalNodeIndices[n]);
+		m_renderableNodes[internalNodeIndices[n]]->setVisible(true);
+	}
+}
+
+void PagedRenderableVolume::evict(int internalNodeIndex)
+{
+	PagedInternalNode& node = m_internalNodes[internalNodeIndex];
+	assert(node.resident);
+
+	m_freeSlots.insert(m_freeSlots.end(), node.slots.begin(), node.slots.end());
+	node.slots.clear();
+
+	std::vector<int>& data = m_indirectionMap->getData();
+	int firstEntryIndex = m_indirectionMap->getFirstEntryIndex(internalNodeIndex);
+	std::fill(data.begin() + firstEntryIndex, data.begin() + firstEntryIndex + m_indirectionMap->getEntryCount(internalNodeIndex), -1);
+	uploadIndirectionEntries(internalNodeIndex);
+	node.resident = false;
+	m_renderableNodes[internalNodeIndex]->setVisible(false);
+	m_lru.erase(node.lruPosition);
+}
+
+void PagedRenderableVolume::uploadIndirectionEntries(int internalNodeIndex)
+{
+	int firstEntryIndex = m_indirectionMap->getFirstEntryIndex(internalNodeIndex);
+	int sizeBytes = m_indirectionMap->getEntryCount(internalNodeIndex) * sizeof(int);
+	m_indirectionBuffer->setData(&m_indirectionMap->getData()[firstEntryIndex], sizeBytes, firstEntryIndex * sizeof(int));
+}
+
+glm::ivec3 PagedRenderableVolume::getSlotOffset(int slot) const
+{
+	int x = slot % m_maxLeafCountPerAtlasDimension.x;
+	int y = (slot / m_maxLeafCountPerAtlasDimension.x) % m_maxLeafCountPerAtlasDimension.y;
+	int z = slot / (m_maxLeafCountPerAtlasDimension.x * m_maxLeafCountPerAtlasDimension.y);
+	return glm::ivec3(x, y, z) * m_leafWidth;
+}
+
+} // namespace GSparseVolumes
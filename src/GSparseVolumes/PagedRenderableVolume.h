@@ -0,0 +1,112 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "GSparseVolumesFwd.h"
+#include "RenderableVolumeFactory.h"
+
+#include <GVis/GVisFwd.h>
+#include <GVis/Math.h>
+
+#include <boost/scoped_ptr.hpp>
+#include <list>
+#include <vector>
+
+namespace GSparseVolumes {
+
+struct PagedVolumeConfig
+{
+	PagedVolumeConfig() :
+		cacheLeafCount(32768),
+		maxInternalNodeLoadsPerUpdate(16)
+	{
+	}
+
+	//! Number of leaves which fit in the GPU atlas cache for each grid
+	int cacheLeafCount;
+
+	//! Limits the number of InternalNodes uploaded by each call to update()
+	int maxInternalNodeLoadsPerUpdate;
+};
+
+/*!
+Renders a sparse volume whose leaves do not all fit in GPU memory.
+Each grid has a single fixed-size atlas which is used as a brick cache. The grids stay fully loaded in host memory,
+and a leaf's voxels are uploaded to the atlas when its InternalNode becomes visible.
+InternalNodes are paged in nearest first and evicted least recently visible first. All bricks loaded by one update()
+are staged in a pixel unpack buffer per grid and copied into the atlas from there.
+Each InternalNode is rendered as its own box, which is hidden while the node is not resident.
+*/
+class PagedRenderableVolume
+{
+public:
+	//! config.batchBoxes, config.instanceBoxes, config.maxLeavesPerAtlas, config.atlasPackingMode and config.voxelFormats are ignored.
+	//! Cache atlases always use VoxelFormat_UNorm8.
+	PagedRenderableVolume(const RenderableVolumeConfig& config, const PagedVolumeConfig& pagedConfig);
+	~PagedRenderableVolume();
+
+	//! Loads and evicts InternalNodes based on visibility from camera. Call once per frame before rendering.
+	void update(const GVis::Camera& camera);
+
+	const std::vector<GVis::RenderableNodePtr>& getNodes() const {return m_renderableNodes;}
+
+	int getResidentLeafCount() const {return m_cacheLeafCount - (int)m_freeSlots.size();}
+
+private:
+	struct PagedInternalNode
+	{
+		InternalNodes internalNodes; //!< One per grid
+		int leafCount;
+		bool resident;
+		std::vector<int> slots; //!< Atlas slots of resident leaves
+		std::list<int>::iterator lruPosition;
+	};
+
+	//! Uploads the leaves of InternalNodes whose slots have been allocated
+	void load(const std::vector<int>& internalNodeIndices);
+	void evict(int internalNodeIndex);
+	//! Uploads the indirection entries of an InternalNode's leaves from m_indirectionMap
+	void uploadIndirectionEntries(int internalNodeIndex);
+	glm::ivec3 getSlotOffset(int slot) const;
+
+private:
+	std::vector<GridPtr> m_grids;
+	std::vector<PagedInternalNode> m_internalNodes;
+	std::vector<GVis::RenderableNodePtr> m_renderableNodes;
+	glm::vec3 m_boxSize;
+
+	std::vector<GVis::TexturePtr> m_atlases; //!< One per grid
+	glm::ivec3 m_maxLeafCountPerAtlasDimension;
+	int m_leafWidth;
+	int m_cacheLeafCount;
+	std::vector<int> m_freeSlots;
+	std::vector<GVis::PixelUnpackBufferPtr> m_stagingBuffers; //!< One per grid
+
+	boost::scoped_ptr<NodeIndirectionMap> m_indirectionMap;
+	GVis::ScopedTextureBufferObjectPtr m_indirectionBuffer;
+
+	//! Resident InternalNode indices, most recently visible first
+	std::list<int> m_lru;
+
+	int m_maxInternalNodeLoadsPerUpdate;
+};
+
+} // namespace GSparseVolumes
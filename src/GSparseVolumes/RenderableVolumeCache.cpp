@@ -0,0 +1,427 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "RenderableVolumeCache.h"
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstring>
+#include <stdexcept>
+
+using namespace GVis;
+namespace bip = boost::interprocess;
+
+namespace GSparseVolumes {
+
+namespace {
+
+const char cacheMagic[4] = {'G', 'S', 'V', 'C'};
+const boost::int32_t cacheVersion = 3;
+
+//! Blobs are aligned so that mapped data can be read as ints and floats
+const size_t blobAlignment = 16;
+
+// File layout: FileHeader, blobs, then the table at FileHeader::tableOffset:
+// VolumeRecord, GridRecord per grid, AtlasRecord per atlas, ImageRecord per atlas per LOD level per grid.
+// Record sizes are multiples of 8 bytes so that every record in the table is aligned.
+
+struct FileHeader
+{
+	char magic[4];
+	boost::int32_t version;
+	boost::uint64_t tableOffset;
+};
+
+struct VolumeRecord
+{
+	boost::int32_t gridCount;
+	boost::int32_t lodLevelCount;
+	boost::int32_t atlasCount;
+	boost::int32_t batchBoxes;
+	boost::int32_t maxLeafCountPerInternalNodeDimension;
+	boost::int32_t voxelCountPerLeafDimension;
+	boost::int32_t internalNodeCount;
+	float boxSize[3];
+	boost::uint64_t indirectionOffset;
+	boost::uint64_t indirectionCount;
+};
+
+struct GridRecord
+{
+	boost::int32_t channelCount;
+	boost::int32_t voxelFormatId;
+};
+
+struct AtlasRecord
+{
+	boost::int32_t firstInternalNodeIndex;
+	boost::int32_t boxCount;
+	boost::uint64_t boxCentersOffset;
+};
+
+struct ImageRecord
+{
+	boost::int32_t pixelFormatId;
+	boost::int32_t width;
+	boost::int32_t height;
+	boost::int32_t depth;
+	boost::int32_t maxLeafCountPerAtlasDimension[3];
+	boost::int32_t padding;
+	boost::uint64_t dataOffset;
+	boost::uint64_t dataSizeBytes;
+};
+
+//! Maps a format enum to the id stored in cache files. Ids must never change once written; add new formats with new ids.
+template <typename T>
+struct FormatId
+{
+	T format;
+	boost::int32_t id;
+};
+
+const FormatId<PixelFormat> pixelFormatIds[] = {
+	{PixelFormat_R8, 1},
+	{PixelFormat_R16, 2},
+	{PixelFormat_R16F, 3},
+	{PixelFormat_RGB8, 4},
+	{PixelFormat_SRGB8, 5},
+	{PixelFormat_RGBA8, 6},
+	{PixelFormat_SRGB8_ALPHA8, 7},
+	{PixelFormat_RGB32F, 8},
+	{PixelFormat_R32F, 9},
+	{PixelFormat_R32I, 10},
+	{PixelFormat_DepthComponent24, 11},
+	{PixelFormat_DXT1, 12},
+	{PixelFormat_DXT1_SRGB_ALPHA, 13},
+	{PixelFormat_DXT3, 14},
+	{PixelFormat_DXT3_SRGB_ALPHA, 15},
+	{PixelFormat_DXT5, 16},
+	{PixelFormat_DXT5_SRGB_ALPHA, 17},
+	{PixelFormat_BC4, 18},
+	{PixelFormat_BC5, 19}
+};
+
+const FormatId<VoxelFormat> voxelFormatIds[] = {
+	{VoxelFormat_UNorm8, 1},
+	{VoxelFormat_UNorm16, 2},
+	{VoxelFormat_Float16, 3},
+	{VoxelFormat_BC4, 4},
+	{VoxelFormat_BC5, 5}
+};
+
+template <typename T, size_t N>
+boost::int32_t toFormatId(const FormatId<T> (&ids)[N], T format)
+{
+	for (size_t i = 0; i < N; ++i)
+	{
+		if (ids[i].format == format)
+		{
+			return ids[i].id;
+		}
+	}
+	throw std::runtime_error("Format has no cache file id");
+}
+
+//! @return false if id is unknown
+template <typename T, size_t N>
+bool fromFormatId(const FormatId<T> (&ids)[N], boost::int32_t id, T& format)
+{
+	for (size_t i = 0; i < N; ++i)
+	{
+		if (ids[i].id == id)
+		{
+			format = ids[i].format;
+			return true;
+		}
+	}
+	return false;
+}
+
+template <typename T>
+void appendRecord(std::vector<unsigned char>& records, const T& record)
+{
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&record);
+	records.insert(records.end(), bytes, bytes + sizeof(T));
+}
+
+} // anonymous namespace
+
+RenderableVolumeCacheWriter::RenderableVolumeCacheWriter(const std::string& filename) :
+	m_filename(filename),
+	m_tempFilename(filename + ".tmp"),
+	m_atlasCount(0),
+	m_finished(false)
+{
+	m_file.open(m_tempFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!m_file)
+	{
+		throw std::runtime_error("Could not create cache file: " + m_tempFilename);
+	}
+
+	// Header is rewritten with the table offset by finish()
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+RenderableVolumeCacheWriter::~RenderableVolumeCacheWriter()
+{
+	if (!m_finished)
+	{
+		m_file.close();
+		boost::system::error_code error;
+		boost::filesystem::remove(m_tempFilename, error);
+	}
+}
+
+unsigned long long RenderableVolumeCacheWriter::writeBlob(const void* data, size_t sizeBytes)
+{
+	unsigned long long offset = (unsigned long long)m_file.tellp();
+	size_t paddingBytes = (blobAlignment - offset % blobAlignment) % blobAlignment;
+
+	static const char padding[blobAlignment] = {0};
+	m_file.write(padding, paddingBytes);
+	offset += paddingBytes;
+
+	m_file.write(static_cast<const char*>(data), sizeBytes);
+	if (!m_file)
+	{
+		throw std::runtime_error("Failed to write cache file: " + m_tempFilename);
+	}
+	return offset;
+}
+
+void RenderableVolumeCacheWriter::addAtlas(const CachedAtlas& atlas)
+{
+	assert(!m_finished);
+	assert(atlas.lodImages.size() == atlas.lodMaxLeafCountPerAtlasDimension.size());
+
+	AtlasRecord atlasRecord;
+	atlasRecord.firstInternalNodeIndex = atlas.firstInternalNodeIndex;
+	atlasRecord.boxCount = (boost::int32_t)atlas.boxCenters.size();
+	atlasRecord.boxCentersOffset = writeBlob(&atlas.boxCenters[0], atlas.boxCenters.size() * sizeof(glm::vec3));
+	appendRecord(m_atlasRecords, atlasRecord);
+
+	for (size_t lod = 0; lod < atlas.lodImages.size(); ++lod)
+	{
+		for (size_t grid = 0; grid < atlas.lodImages[lod].size(); ++grid)
+		{
+			const CachedAtlasImage& image = atlas.lodImages[lod][grid];
+
+			ImageRecord imageRecord;
+			imageRecord.pixelFormatId = toFormatId(pixelFormatIds, image.format);
+			imageRecord.width = image.width;
+			imageRecord.height = image.height;
+			imageRecord.depth = image.depth;
+			for (int i = 0; i < 3; ++i)
+			{
+				imageRecord.maxLeafCountPerAtlasDimension[i] = atlas.lodMaxLeafCountPerAtlasDimension[lod][i];
+			}
+			imageRecord.padding = 0;
+			imageRecord.dataOffset = writeBlob(image.data, image.sizeBytes);
+			imageRecord.dataSizeBytes = image.sizeBytes;
+			appendRecord(m_imageRecords, imageRecord);
+		}
+	}
+	++m_atlasCount;
+}
+
+void RenderableVolumeCacheWriter::finish(const CachedVolumeInfo& info, const int* indirectionData, size_t indirectionCount)
+{
+	assert(!m_finished);
+	assert(m_imageRecords.size() == m_atlasCount * info.lodLevelCount * info.gridChannelCounts.size() * sizeof(ImageRecord));
+	assert(info.gridVoxelFormats.size() == info.gridChannelCounts.size());
+
+	VolumeRecord volumeRecord;
+	volumeRecord.gridCount = (boost::int32_t)info.gridChannelCounts.size();
+	volumeRecord.lodLevelCount = info.lodLevelCount;
+	volumeRecord.atlasCount = m_atlasCount;
+	volumeRecord.batchBoxes = info.batchBoxes ? 1 : 0;
+	volumeRecord.maxLeafCountPerInternalNodeDimension = info.maxLeafCountPerInternalNodeDimension;
+	volumeRecord.voxelCountPerLeafDimension = info.voxelCountPerLeafDimension;
+	volumeRecord.internalNodeCount = info.internalNodeCount;
+	for (int i = 0; i < 3; ++i)
+	{
+		volumeRecord.boxSize[i] = info.boxSize[i];
+	}
+	volumeRecord.indirectionOffset = writeBlob(indirectionData, indirectionCount * sizeof(int));
+	volumeRecord.indirectionCount = indirectionCount;
+
+	// Write table
+	std::vector<unsigned char> table;
+	appendRecord(table, volumeRecord);
+	for (size_t i = 0; i < info.gridChannelCounts.size(); ++i)
+	{
+		GridRecord gridRecord;
+		gridRecord.channelCount = info.gridChannelCounts[i];
+		gridRecord.voxelFormatId = toFormatId(voxelFormatIds, info.gridVoxelFormats[i]);
+		appendRecord(table, gridRecord);
+	}
+	table.insert(table.end(), m_atlasRecords.begin(), m_atlasRecords.end());
+	table.insert(table.end(), m_imageRecords.begin(), m_imageRecords.end());
+
+	FileHeader header;
+	memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = cacheVersion;
+	header.tableOffset = writeBlob(&table[0], table.size());
+
+	m_file.seekp(0);
+	m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	m_file.close();
+	if (!m_file)
+	{
+		throw std::runtime_error("Failed to write cache file: " + m_tempFilename);
+	}
+
+	boost::filesystem::rename(m_tempFilename, m_filename);
+	m_finished = true;
+}
+
+//! Checks that records read from a mapped file lie within it
+class MappedFileReader
+{
+public:
+	MappedFileReader(const unsigned char* data, size_t size, const std::string& filename) :
+		m_data(data),
+		m_size(size),
+		m_filename(filename)
+	{
+	}
+
+	const unsigned char* getRange(boost::uint64_t offset, boost::uint64_t sizeBytes) const
+	{
+		if (offset > m_size || sizeBytes > m_size - offset)
+		{
+			throw std::runtime_error("Cache file is truncated or corrupt: " + m_filename);
+		}
+		return m_data + offset;
+	}
+
+	template <typename T>
+	const T& read(boost::uint64_t& offset) const
+	{
+		const T* record = reinterpret_cast<const T*>(getRange(offset, sizeof(T)));
+		offset += sizeof(T);
+		return *record;
+	}
+
+private:
+	const unsigned char* m_data;
+	size_t m_size;
+	std::string m_filename;
+};
+
+RenderableVolumeCacheReader::RenderableVolumeCacheReader(const std::string& filename) :
+	m_indirectionData(0),
+	m_indirectionCount(0)
+{
+	try
+	{
+		m_mapping.reset(new bip::file_mapping(filename.c_str(), bip::read_only));
+		m_region.reset(new bip::mapped_region(*m_mapping, bip::read_only));
+	}
+	catch (const bip::interprocess_exception& e)
+	{
+		throw std::runtime_error("Could not map cache file: " + filename + ": " + e.what());
+	}
+
+	MappedFileReader reader(static_cast<const unsigned char*>(m_region->get_address()), m_region->get_size(), filename);
+
+	boost::uint64_t offset = 0;
+	const FileHeader& header = reader.read<FileHeader>(offset);
+	if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion)
+	{
+		throw std::runtime_error("Not a cache file of the current version: " + filename);
+	}
+
+	offset = header.tableOffset;
+	const VolumeRecord& volumeRecord = reader.read<VolumeRecord>(offset);
+	m_info.lodLevelCount = volumeRecord.lodLevelCount;
+	m_info.batchBoxes = (volumeRecord.batchBoxes != 0);
+	m_info.boxSize = glm::vec3(volumeRecord.boxSize[0], volumeRecord.boxSize[1], volumeRecord.boxSize[2]);
+	m_info.maxLeafCountPerInternalNodeDimension = volumeRecord.maxLeafCountPerInternalNodeDimension;
+	m_info.voxelCountPerLeafDimension = volumeRecord.voxelCountPerLeafDimension;
+	m_info.internalNodeCount = volumeRecord.internalNodeCount;
+
+	for (int i = 0; i < volumeRecord.gridCount; ++i)
+	{
+		const GridRecord& gridRecord = reader.read<GridRecord>(offset);
+		VoxelFormat voxelFormat;
+		if (!fromFormatId(voxelFormatIds, gridRecord.voxelFormatId, voxelFormat))
+		{
+			throw std::runtime_error("Cache file has unknown voxel format: " + filename);
+		}
+		m_info.gridChannelCounts.push_back(gridRecord.channelCount);
+		m_info.gridVoxelFormats.push_back(voxelFormat);
+	}
+
+	m_indirectionData = reinterpret_cast<const int*>(reader.getRange(volumeRecord.indirectionOffset, volumeRecord.indirectionCount * sizeof(int)));
+	m_indirectionCount = volumeRecord.indirectionCount;
+
+	m_atlases.resize(volumeRecord.atlasCount);
+	for (int a = 0; a < volumeRecord.atlasCount; ++a)
+	{
+		const AtlasRecord& atlasRecord = reader.read<AtlasRecord>(offset);
+		CachedAtlas& atlas = m_atlases[a];
+		atlas.firstInternalNodeIndex = atlasRecord.firstInternalNodeIndex;
+
+		const glm::vec3* boxCenters = reinterpret_cast<const glm::vec3*>(reader.getRange(atlasRecord.boxCentersOffset, atlasRecord.boxCount * sizeof(glm::vec3)));
+		atlas.boxCenters.assign(boxCenters, boxCenters + atlasRecord.boxCount);
+	}
+
+	for (int a = 0; a < volumeRecord.atlasCount; ++a)
+	{
+		CachedAtlas& atlas = m_atlases[a];
+		atlas.lodImages.resize(volumeRecord.lodLevelCount);
+		for (int lod = 0; lod < volumeRecord.lodLevelCount; ++lod)
+		{
+			for (int grid = 0; grid < volumeRecord.gridCount; ++grid)
+			{
+				const ImageRecord& imageRecord = reader.read<ImageRecord>(offset);
+
+				CachedAtlasImage image;
+				if (!fromFormatId(pixelFormatIds, imageRecord.pixelFormatId, image.format))
+				{
+					throw std::runtime_error("Cache file has unknown pixel format: " + filename);
+				}
+				image.width = imageRecord.width;
+				image.height = imageRecord.height;
+				image.depth = imageRecord.depth;
+				image.data = reader.getRange(imageRecord.dataOffset, imageRecord.dataSizeBytes);
+				image.sizeBytes = imageRecord.dataSizeBytes;
+				atlas.lodImages[lod].push_back(image);
+
+				if (grid == 0)
+				{
+					const boost::int32_t* dims = imageRecord.maxLeafCountPerAtlasDimension;
+					atlas.lodMaxLeafCountPerAtlasDimension.push_back(glm::ivec3(dims[0], dims[1], dims[2]));
+				}
+			}
+		}
+	}
+}
+
+RenderableVolumeCacheReader::~RenderableVolumeCacheReader()
+{
+}
+
+} // namespace GSparseVolumes
@@ -0,0 +1,138 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "VoxelFormat.h"
+
+#include <GVis/Math.h>
+#include <GVis/Texture.h>
+
+#include <boost/scoped_ptr.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace boost { namespace interprocess {
+class file_mapping;
+class mapped_region;
+}} // namespace boost::interprocess
+
+namespace GSparseVolumes {
+
+//! Texture image of an atlas in a cache file
+struct CachedAtlasImage
+{
+	GVis::PixelFormat format;
+	int width;
+	int height;
+	int depth;
+	const unsigned char* data; //!< In the layout expected by format
+	size_t sizeBytes;
+};
+
+//! Resources of one atlas of a RenderableVolume in a cache file
+struct CachedAtlas
+{
+	int firstInternalNodeIndex;
+
+	//! Center of each InternalNode box in the atlas, scaled and offset
+	std::vector<glm::vec3> boxCenters;
+
+	std::vector<glm::ivec3> lodMaxLeafCountPerAtlasDimension;
+
+	//! Indexed by [lodLevel][grid]
+	std::vector<std::vector<CachedAtlasImage> > lodImages;
+};
+
+struct CachedVolumeInfo
+{
+	std::vector<int> gridChannelCounts;
+	std::vector<VoxelFormat> gridVoxelFormats; //!< One per grid, in the same order as gridChannelCounts
+	int lodLevelCount;
+	bool batchBoxes;
+	glm::vec3 boxSize; //!< Scaled size of an InternalNode box
+	int maxLeafCountPerInternalNodeDimension;
+	int voxelCountPerLeafDimension;
+	int internalNodeCount;
+};
+
+/*!
+Writes a built RenderableVolume to a cache file which can be read back with RenderableVolumeCacheReader.
+Atlas images are written as they are added, so callers need not keep host copies of all atlases.
+The file is written to a temporary name and renamed by finish(), so an interrupted write never leaves a partial cache.
+The format is native endian and versioned, and is only intended to be read on the machine that wrote it.
+Pixel and voxel formats are stored as stable ids rather than enum values, so reordering the enums does not break existing files.
+*/
+class RenderableVolumeCacheWriter
+{
+public:
+	//! Throws if the file can't be created
+	explicit RenderableVolumeCacheWriter(const std::string& filename);
+	~RenderableVolumeCacheWriter();
+
+	//! Writes the atlas images. Atlases must be added in order.
+	void addAtlas(const CachedAtlas& atlas);
+
+	//! Writes the indirection buffer and table of contents, and closes the file
+	void finish(const CachedVolumeInfo& info, const int* indirectionData, size_t indirectionCount);
+
+private:
+	//! Writes data aligned for mapping. @return offset of the data in the file.
+	unsigned long long writeBlob(const void* data, size_t sizeBytes);
+
+private:
+	std::string m_filename;
+	std::string m_tempFilename;
+	std::ofstream m_file;
+	int m_atlasCount;
+	std::vector<unsigned char> m_atlasRecords; //!< Table entries, written by finish()
+	std::vector<unsigned char> m_imageRecords;
+	bool m_finished;
+};
+
+/*!
+Memory maps a cache file written by RenderableVolumeCacheWriter.
+Image and indirection data point directly into the mapping, so they can be uploaded without copying.
+*/
+class RenderableVolumeCacheReader
+{
+public:
+	//! Throws if the file can't be mapped or is not a valid cache file of the current version
+	explicit RenderableVolumeCacheReader(const std::string& filename);
+	~RenderableVolumeCacheReader();
+
+	const CachedVolumeInfo& getInfo() const {return m_info;}
+	const std::vector<CachedAtlas>& getAtlases() const {return m_atlases;}
+
+	const int* getIndirectionData() const {return m_indirectionData;}
+	size_t getIndirectionCount() const {return m_indirectionCount;}
+
+private:
+	boost::scoped_ptr<boost::interprocess::file_mapping> m_mapping;
+	boost::scoped_ptr<boost::interprocess::mapped_region> m_region;
+
+	CachedVolumeInfo m_info;
+	std::vector<CachedAtlas> m_atlases;
+	const int* m_indirectionData;
+	size_t m_indirectionCount;
+};
+
+} // namespace GSparseVolumes
@@ -22,248 +22,597 @@
 #include "BoxBatchBuilder.h"
 #include "InternalNode.h"
 #include "Grid.h"
+#include "GridTopology.h"
 #include "GridVectorIterators.h"
 #include "Leaf.h"
+#include "NodeIndirectionMap.h"
+#include "RenderableVolumeCache.h"
 #include "VolumeTextureAtlasBuilder.h"
 
 #include <GVis/RenderableNode.h>
 #include <GVis/Geo.h>
+#include <GVis/Mesh.h>
 #include <GVis/Texture.h>
 #include <GVis/TextureBufferObject.h>
 #include <GCommon/Logger.h>
+#include <GCommon/ParallelFor.h>
 
-#include <boost/scoped_array.hpp>
-#include <cstring>
+#include <algorithm>
+#include <boost/bind/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
 #include <stdexcept>
 
+using namespace boost::placeholders;
 using namespace GCommon;
 using namespace GVis;
 
 namespace GSparseVolumes {
 
-class NodeIndirectionMapBuilder
+static TexturePtr createNodeIndirectionTexture(const int* data, size_t size)
 {
-public:
-	explicit NodeIndirectionMapBuilder(size_t size) :
-		m_size(size)
-	{
-		// TODO: consider making this unsigned int to handle more nodes...only half the possible index values will be used
-		int sizeBytes = size * sizeof(int);
+	TextureBufferObjectPtr tbo(new ScopedTextureBufferObject(const_cast<int*>(data), size, sizeof(int)));
+	BufferTextureConfig bufferTextureConfig(PixelFormat_R32I, tbo);
+	return TexturePtr(new Texture(bufferTextureConfig));
+}
 
-		m_buffer.reset(new int[size]);
-		memset(m_buffer.get(), -1, sizeBytes);
-	}
+//! Copy of a leaf into a reserved atlas slot, deferred so that copies can run in parallel
+struct LeafCopyJob
+{
+	LeafCopyJob(const LeafPtr& leaf, VolumeTextureAtlasBuilder* atlasBuilder, const glm::ivec3& offset) :
+		leaf(leaf), atlasBuilder(atlasBuilder), offset(offset) {}
+
+	LeafPtr leaf;
+	VolumeTextureAtlasBuilder* atlasBuilder;
+	glm::ivec3 offset;
+};
+
+static void runLeafCopyJob(const std::vector<LeafCopyJob>& jobs, int index)
+{
+	const LeafCopyJob& job = jobs[index];
+	job.atlasBuilder->fillItemSlot(*job.leaf, job.offset);
+}
+
+//! @param atlasLeafCounts outputs the number of leaves in each atlas
+std::vector<int> calcAtlasInternalNodeCounts(const GridTopology& topology, int maxLeavesPerAtlas, std::vector<int>& atlasLeafCounts)
+{
+	std::vector<int> result;
 
-	void addChildReference(int referenceLocation, int referencedChild)
+	int internalNodeIndex = 0;
+	while (internalNodeIndex < topology.getInternalNodeCount())
 	{
-		m_buffer[referenceLocation] = referencedChild;
+		// calculate InternalNode count for this atlas
+		int internalNodeCount = 0;
+		int leafCount = 0;
+		for (; internalNodeIndex < topology.getInternalNodeCount(); ++internalNodeIndex)
+		{
+			int nodeLeafCount = topology.getLeafCount(internalNodeIndex);
+			if (leafCount + nodeLeafCount >= maxLeavesPerAtlas)
+			{
+				break;
+			}
+
+			leafCount += nodeLeafCount;
+			internalNodeCount++;
+		}
+
+		if (internalNodeCount == 0)
+		{
+			throw std::runtime_error("Too many leaves in InternalNode to fit in a single texture atlas");
+		}
+		result.push_back(internalNodeCount);
+		atlasLeafCounts.push_back(leafCount);
 	}
 
-	TexturePtr build()
+	return result;
+}
+
+//! Writing the cache is best-effort, so failures are logged rather than thrown
+static void logCacheWriteFailure(const std::exception& e)
+{
+	defaultLogger()->logLine(std::string("Not writing atlas cache: ") + e.what());
+}
+
+//! Clamps config.lodLevelCount so that leaves at the lowest level remain wide enough for every grid's atlas format
+static int calcLodLevelCount(const RenderableVolumeConfig& config)
+{
+	int lodLevelCount = std::max(1, config.lodLevelCount);
+	for (int i = 0; i < config.grids.size(); ++i)
 	{
-		TextureBufferObjectPtr tbo(new ScopedTextureBufferObject(m_buffer.get(), m_size, sizeof(int)));
-		BufferTextureConfig bufferTextureConfig(PixelFormat_R32I, tbo);
-		TexturePtr texture(new Texture(bufferTextureConfig));
-		return texture;
+		const GridPtr& grid = config.grids[i];
+		int minLeafWidth = isBlockCompressedVoxelFormat(config.getVoxelFormat(grid)) ? 4 : 1;
+		while (lodLevelCount > 1 && (grid->getVoxelCountPerLeafDimension() >> (lodLevelCount - 1)) < minLeafWidth)
+		{
+			--lodLevelCount;
+		}
 	}
+	return lodLevelCount;
+}
 
-private:
-	boost::scoped_array<int> m_buffer;
-	size_t m_size;
+typedef shared_ptr<VolumeTextureAtlasBuilder> VolumeTextureAtlasBuilderPtr;
+typedef std::vector<VolumeTextureAtlasBuilderPtr> VolumeTextureAtlasBuilders;
+
+//! GPU resources of one atlas, and the InternalNodes it holds
+struct UploadedAtlas
+{
+	int firstInternalNodeIndex;
+	std::vector<glm::vec3> boxCenters; //!< Center of each InternalNode box, scaled and offset
+	std::vector<GridTexturesMap> lodTextures;
+	std::vector<glm::ivec3> lodMaxLeafCountPerAtlasDimension;
 };
 
-TexturePtr buildNodeIndirectionTexture(const Grid& grid, std::vector<int> atlasInternalNodeCounts)
+//! Atlas whose leaf slots and boxes have been assigned. Leaves are copied by fill() and textures are created by upload().
+struct PendingAtlas
 {
-	InternalNodeIteratorPtr nodeIterator = grid.createInternalNodeIterator();
+	std::vector<VolumeTextureAtlasBuilders> lodAtlasBuilders; //!< Indexed by [lodLevel][grid]
+	std::vector<LeafCopyJob> leafCopyJobs;
+	UploadedAtlas result;
 
-	int internalNodeIndex = 0;
-	size_t maxLeafCountPerInternalNode = grid.getMaxLeafCountPerInternalNode();
-	NodeIndirectionMapBuilder indirectionMapBuilder(grid.getInternalNodeCount() * maxLeafCountPerInternalNode);
+	//! Copies leaves into the atlas builders. Does not use the GL context, so may run on any thread.
+	void fill(int threadCount)
+	{
+		GCommon::parallelFor(leafCopyJobs.size(), threadCount, boost::bind(&runLeafCopyJob, boost::cref(leafCopyJobs), _1));
+		leafCopyJobs.clear();
+	}
 
-	for (int atlasIndex = 0; atlasIndex < atlasInternalNodeCounts.size(); ++atlasIndex)
+	//! Creates textures and releases the host copies of the atlases. Must run on the GL thread.
+	//! @param cacheWriter if not null, the atlas images are also written to the cache
+	//! @return false if writing to the cache failed. The failure has been logged and the writer should be discarded.
+	bool upload(const std::vector<GridPtr>& grids, RenderableVolumeCacheWriter* cacheWriter)
 	{
-		int leafIndexInAtlas = 0;
-		int internalNodeIndexInAtlas = 0;
-		while (internalNodeIndexInAtlas < atlasInternalNodeCounts[atlasIndex])
-		{
-			const InternalNodePtr& internalNode = nodeIterator->next();
-			assert(internalNode);
-			LeafIteratorPtr leafIterator = internalNode->createLeafIterator();
+		CachedAtlas cachedAtlas;
+		std::vector<std::vector<unsigned char> > compressedData(lodAtlasBuilders.size() * grids.size());
 
-			while (const LeafPtr& leaf = leafIterator->next())
+		result.lodTextures.resize(lodAtlasBuilders.size());
+		for (int lod = 0; lod < lodAtlasBuilders.size(); ++lod)
+		{
+			cachedAtlas.lodImages.push_back(std::vector<CachedAtlasImage>());
+			for (int i = 0; i < grids.size(); ++i)
 			{
-				int tboIndex = internalNodeIndex * maxLeafCountPerInternalNode + leaf->getIndexInInternalNode();
-				indirectionMapBuilder.addChildReference(tboIndex, leafIndexInAtlas);
+				ImageTextureConfig textureConfig = lodAtlasBuilders[lod][i]->getTextureConfig(compressedData[lod * grids.size() + i]);
+				result.lodTextures[lod][grids[i]] = TexturePtr(new Texture(textureConfig));
+
+				CachedAtlasImage image;
+				image.format = textureConfig.format;
+				image.width = textureConfig.width;
+				image.height = textureConfig.height;
+				image.depth = textureConfig.depth;
+				image.data = textureConfig.data;
+				image.sizeBytes = getImageSizeBytes(image.width, image.height, image.depth, image.format);
+				cachedAtlas.lodImages.back().push_back(image);
+			}
+			result.lodMaxLeafCountPerAtlasDimension.push_back(lodAtlasBuilders[lod].front()->getMaxItemCountPerDimension());
+		}
 
-				++leafIndexInAtlas;
+		bool cacheWriteSucceeded = true;
+		if (cacheWriter)
+		{
+			cachedAtlas.firstInternalNodeIndex = result.firstInternalNodeIndex;
+			cachedAtlas.boxCenters = result.boxCenters;
+			cachedAtlas.lodMaxLeafCountPerAtlasDimension = result.lodMaxLeafCountPerAtlasDimension;
+			try
+			{
+				cacheWriter->addAtlas(cachedAtlas);
+			}
+			catch (const std::exception& e)
+			{
+				logCacheWriteFailure(e);
+				cacheWriteSucceeded = false;
 			}
-			++internalNodeIndex;
-			++internalNodeIndexInAtlas;
 		}
+
+		lodAtlasBuilders.clear();
+		return cacheWriteSucceeded;
 	}
+};
+
+typedef shared_ptr<PendingAtlas> PendingAtlasPtr;
 
-	assert(internalNodeIndex > 0);
-	return indirectionMapBuilder.build();
+//! Runs atlas->fill and captures any exception in exception so it can be rethrown on the calling thread
+static void fillCapturingException(PendingAtlas* atlas, int threadCount, boost::exception_ptr& exception)
+{
+	try
+	{
+		atlas->fill(threadCount);
+	}
+	catch (...)
+	{
+		exception = boost::current_exception();
+	}
 }
 
-std::vector<int> calcAtlasInternalNodeCounts(const Grid& grid, int maxLeavesPerAtlas)
+//! Creates box meshes, materials and renderable nodes for uploaded atlases
+static RenderableVolumePtr assembleRenderableVolume(const RenderableVolumeConfig& config, const glm::vec3& boxSize, int maxLeafCountPerInternalNodeDimension,
+													int voxelCountPerLeafDimension, const TexturePtr& nodeIndirectionTexture, const std::vector<UploadedAtlas>& atlases)
 {
-	std::vector<int> result;
-	InternalNodeIteratorPtr i = grid.createInternalNodeIterator();
+	RenderableVolumePtr volume(new RenderableVolume);
+	volume->internalNodeBoxSize = boxSize;
+	volume->voxelCountPerInternalNodeDimension = voxelCountPerLeafDimension * maxLeafCountPerInternalNodeDimension;
 
-	while (i->hasNext())
+	// All InternalNodes are the same size, so unbatched boxes share a mesh
+	MeshPtr unbatchedBoxMesh;
+	if (!config.batchBoxes && !config.instanceBoxes)
 	{
-		// calculate InternalNode count for this atlas
-		int internalNodeCount = 0;
-		int leafCount = 0;
-		while (i->hasNext()) // iterate InternalNodes
+		BoxBatchBuilder b;
+		b.addBox(glm::vec3(0,0,0), boxSize);
+		unbatchedBoxMesh = b.build();
+	}
+
+	for (int a = 0; a < atlases.size(); ++a)
+	{
+		const UploadedAtlas& atlas = atlases[a];
+		int lodLevelCount = (int)atlas.lodTextures.size();
+
+		std::vector<MeshPtr> boxMeshes;
+		std::vector<glm::vec3> boxCenters;
+		if (config.batchBoxes) // one draw call per internal node batch (i.e per texture atlas)
 		{
-			InternalNodeIteratorPtr prevIt = i->clone();
-			const InternalNodePtr node = i->next();
+			BoxBatchBuilder boxBatchBuilder(atlas.boxCenters.size());
+			for (int i = 0; i < atlas.boxCenters.size(); ++i)
+			{
+				boxBatchBuilder.addBox(atlas.boxCenters[i], boxSize);
+			}
+			boxMeshes.push_back(boxBatchBuilder.build());
+			boxCenters.push_back(glm::vec3(0,0,0));
 
-			LeafIteratorPtr leafIt = node->createLeafIterator();
-			while (leafIt->next())
+			glm::vec3 boundsMin, boundsMax;
+			boxBatchBuilder.getBounds(boundsMin, boundsMax);
+			volume->boundsCenters.push_back((boundsMin + boundsMax) * 0.5f);
+			volume->boundsHalfSizes.push_back((boundsMax - boundsMin) * 0.5f);
+		}
+		else if (config.instanceBoxes) // one instanced draw call per internal node batch
+		{
+			glm::vec3 boundsMin = atlas.boxCenters.front();
+			glm::vec3 boundsMax = boundsMin;
+			for (int i = 1; i < atlas.boxCenters.size(); ++i)
 			{
-				leafCount++;
+				boundsMin = glm::min(boundsMin, atlas.boxCenters[i]);
+				boundsMax = glm::max(boundsMax, atlas.boxCenters[i]);
 			}
+			glm::vec3 nodeCenter = (boundsMin + boundsMax) * 0.5f;
 
-			if (leafCount >= maxLeavesPerAtlas)
+			InstancedBoxes instancedBoxes;
+			instancedBoxes.nodeIndex = (int)volume->nodes.size();
+			for (int i = 0; i < atlas.boxCenters.size(); ++i)
 			{
-				i = prevIt;
-				break;
+				instancedBoxes.instances.push_back(glm::vec4(atlas.boxCenters[i] - nodeCenter, (float)i));
 			}
 
-			internalNodeCount++;
+			BoxBatchBuilder b;
+			b.addBox(glm::vec3(0,0,0), boxSize);
+			instancedBoxes.mesh = b.build();
+			instancedBoxes.instanceAttributeIndex = instancedBoxes.mesh->getVertexAttributeCount();
+			instancedBoxes.mesh->addInstanceAttribute((GLfloat&)instancedBoxes.instances[0], (int)instancedBoxes.instances.size() * sizeof(glm::vec4), 4);
+			instancedBoxes.mesh->setInstanceCount((int)instancedBoxes.instances.size());
+			volume->instancedBoxes.push_back(instancedBoxes);
+
+			boxMeshes.push_back(instancedBoxes.mesh);
+			boxCenters.push_back(nodeCenter);
+			volume->boundsCenters.push_back(glm::vec3(0,0,0));
+			volume->boundsHalfSizes.push_back((boundsMax - boundsMin + boxSize) * 0.5f);
+		}
+		else // one draw call per internal node
+		{
+			boxMeshes.assign(atlas.boxCenters.size(), unbatchedBoxMesh);
+			boxCenters = atlas.boxCenters;
+			volume->boundsCenters.insert(volume->boundsCenters.end(), boxCenters.size(), glm::vec3(0,0,0));
+			volume->boundsHalfSizes.insert(volume->boundsHalfSizes.end(), boxCenters.size(), boxSize * 0.5f);
 		}
 
-		if (internalNodeCount == 0)
+		for (int i = 0; i < boxMeshes.size(); ++i)
 		{
-			throw std::runtime_error("Too many leaves in InternalNode to fit in a single texture atlas");
+			std::vector<MaterialPtr> lodMaterials;
+			for (int lod = 0; lod < lodLevelCount; ++lod)
+			{
+				SparseVolumeMaterialConfig materialConfig;
+				materialConfig.boxSize = boxSize;
+				materialConfig.leafAtlases = atlas.lodTextures[lod];
+				materialConfig.leafAtlasFormats = config.voxelFormats;
+				materialConfig.nodeIndirectionTexture = nodeIndirectionTexture;
+				materialConfig.firstInternalNodeIndex = atlas.firstInternalNodeIndex + i;
+				materialConfig.maxLeafCountPerInternalNodeDimension = maxLeafCountPerInternalNodeDimension;
+				materialConfig.maxLeafCountPerAtlasDimension = atlas.lodMaxLeafCountPerAtlasDimension[lod];
+				materialConfig.leafVoxelCountPerDimension = voxelCountPerLeafDimension >> lod;
+				materialConfig.lodLevel = lod;
+
+				lodMaterials.push_back(config.materialFactory->createMaterial(materialConfig));
+			}
+
+			GeoPtr geo(new Geo(boxMeshes[i], lodMaterials.front()));
+
+			int nodeIndex = (int)volume->nodes.size();
+			RenderableNodePtr node(new RenderableNode);
+			node->addRenderable(geo);
+			node->setPosition(boxCenters[i]);
+			node->setLocalBounds(BoundingBox::fromCenterAndHalfSize(volume->boundsCenters[nodeIndex], volume->boundsHalfSizes[nodeIndex]));
+			volume->nodes.push_back(node);
+			volume->geos.push_back(geo);
+			volume->lodMaterials.push_back(lodMaterials);
 		}
-		result.push_back(internalNodeCount);
 	}
-
-	return result;
+	return volume;
 }
 
-RenderableVolumePtr RenderableVolumeFactory::createRenderableVolume(const RenderableVolumeConfig& config)
+//! Builds a RenderableVolume with a single traversal of the grids' leaves
+class RenderableVolumeBuilder
 {
-	RenderableVolumePtr outputVolume(new RenderableVolume);
-
-	if (!config.grids.empty())
+public:
+	RenderableVolumeBuilder(const RenderableVolumeConfig& config, const GridTopology& topology) :
+		m_config(config),
+		m_topology(topology),
+		m_internalNodesIterator(config.grids),
+		m_currentInternalNodeIndex(0),
+		m_indirectionMap(topology, (int)config.grids.front()->getMaxLeafCountPerInternalNode()),
+		m_lodLevelCount(calcLodLevelCount(config))
 	{
-		// Calculate texture atlas sizes
-		std::vector<int> atlasInternalNodeCounts = calcAtlasInternalNodeCounts(*config.grids.front(), config.maxLeavesPerAtlas);
+		m_boxSize = topology.internalNodeSize * config.scale;
 
-		// Build node indirection texture
-		TexturePtr nodeIndirectionTexture = buildNodeIndirectionTexture(*config.grids.front(), atlasInternalNodeCounts);
-
-		int currentInternalNodeIndex = 0;
-		InternalNodesIterator internalNodesIterator(config.grids);
-
-		// Iterate atlases we are going to create
-		for (int atlasIndex = 0; atlasIndex < atlasInternalNodeCounts.size(); ++atlasIndex)
+		if (!config.cacheFilename.empty())
 		{
-			typedef shared_ptr<VolumeTextureAtlasBuilder> VolumeTextureAtlasBuilderPtr;
-			std::vector<VolumeTextureAtlasBuilderPtr> atlasBuilders;
-
-			// Create an atlas builder for each grid
-			for (int i = 0; i < config.grids.size(); ++i)
+			try
+			{
+				m_cacheWriter.reset(new RenderableVolumeCacheWriter(config.cacheFilename));
+			}
+			catch (const std::exception& e)
 			{
-				// TODO: Optimise texture size. Currently we always create texture full sized texture even if only a fraction of the space is used.
-				// In practice only the final texture in a series of atlaes will benifit from this optimisation, so may not be worth implementing.
-				VolumeTextureAtlasBuilderPtr atlasBuilder(new VolumeTextureAtlasBuilder(config.maxLeavesPerAtlas, config.grids[i]->getVoxelCountPerLeafDimension(), config.grids[i]->getChannelCount()));
-				atlasBuilders.push_back(atlasBuilder);
+				logCacheWriteFailure(e);
 			}
+		}
+	}
+
+	/*! Assigns leaf slots, indirection entries and boxes for the next internalNodeCount InternalNodes.
+		Leaves are not copied until PendingAtlas::fill() is called.
+	*/
+	PendingAtlasPtr prepareAtlas(int internalNodeCount, int atlasLeafCount)
+	{
+		PendingAtlasPtr atlas(new PendingAtlas);
+		atlas->result.firstInternalNodeIndex = m_currentInternalNodeIndex;
 
-			// Create objects for creating renderable boxes
-			std::vector<glm::vec3> boxCenters;
-			std::vector<MeshPtr> boxMeshes;
-			glm::vec3 boxSize;
-			BoxBatchBuilder boxBatchBuilder;
+		// Tightly packed atlases are sized for the leaves they actually hold
+		int atlasCapacity = (m_config.atlasPackingMode == AtlasPackingMode_Tight) ? atlasLeafCount : m_config.maxLeavesPerAtlas;
 
-			// Fill up this atlas with leaves from InternalNodes until atlas is full
-			int firstInternalNodeIndexInAtlas = currentInternalNodeIndex;
-			while (currentInternalNodeIndex - firstInternalNodeIndexInAtlas < atlasInternalNodeCounts[atlasIndex])
+		// Create an atlas builder for each grid at each LOD level
+		atlas->lodAtlasBuilders.resize(m_lodLevelCount);
+		for (int lod = 0; lod < m_lodLevelCount; ++lod)
+		{
+			for (int i = 0; i < m_config.grids.size(); ++i)
 			{
-				const InternalNodes* internalNodes = internalNodesIterator.next();
-				assert(internalNodes);
+				const GridPtr& grid = m_config.grids[i];
+				VolumeTextureAtlasBuilderPtr atlasBuilder(new VolumeTextureAtlasBuilder(atlasCapacity, grid->getVoxelCountPerLeafDimension() >> lod, grid->getChannelCount(),
+																						m_config.atlasPackingMode, m_config.getVoxelFormat(grid)));
+				atlas->lodAtlasBuilders[lod].push_back(atlasBuilder);
+			}
+		}
 
-				// Create renderable box for InternalNode
-				{
-					glm::vec3 thisBoxSize = internalNodes->front()->getBoundingBoxSize() * config.scale;
-					glm::vec3 boxCenter = internalNodes->front()->getBoundingBoxCenter() * config.scale;
+		int leafIndexInAtlas = 0;
+		for (int n = 0; n < internalNodeCount; ++n, ++m_currentInternalNodeIndex)
+		{
+			const InternalNodes* internalNodes = m_internalNodesIterator.next();
+			assert(internalNodes);
+			assert(internalNodes->front()->getBoundingBoxSize() * m_config.scale == m_boxSize);
 
-					if (!boxMeshes.empty())
-					{
-						assert(thisBoxSize == boxSize || boxMeshes.empty());
-					}
-					boxSize = thisBoxSize;
+			atlas->result.boxCenters.push_back(m_topology.internalNodeCenters[m_currentInternalNodeIndex] * m_config.scale + m_config.offset);
 
-					if (config.batchBoxes) // one draw call per internal node batch (i.e per texture atlas)
-					{
-						boxBatchBuilder.addBox(boxCenter, boxSize);
-					}
-					else // one draw call per internal node
-					{
-						BoxBatchBuilder b;
-						b.addBox(glm::vec3(0,0,0), boxSize);
-						boxMeshes.push_back(b.build());
-						boxCenters.push_back(boxCenter);
-					}
-				}
+			// Reserve atlas slots for all leaves of this InternalNode and point the indirection map at them
+			LeavesIterator leavesIterator(*internalNodes);
+			while (const Leaves* leaves = leavesIterator.next())
+			{
+				m_indirectionMap.setLeafSlot(m_currentInternalNodeIndex, leaves->front()->getIndexInInternalNode(), leafIndexInAtlas++);
 
-				// Add all leaves of this InternalNode to atlases
-				LeavesIterator leavesIterator(*internalNodes);
-				while (const Leaves* leaves = leavesIterator.next())
+				for (int i = 0; i < leaves->size(); ++i)
 				{
-					for (int i = 0; i < leaves->size(); ++i)
+					const LeafPtr& leaf = (*leaves)[i];
+					assert(leaf->getVoxelCountPerDimension() == m_config.grids[i]->getVoxelCountPerLeafDimension());
+					for (int lod = 0; lod < m_lodLevelCount; ++lod)
 					{
-						atlasBuilders[i]->addTexture(*(*leaves)[i]);
+						VolumeTextureAtlasBuilder* atlasBuilder = atlas->lodAtlasBuilders[lod][i].get();
+						atlas->leafCopyJobs.push_back(LeafCopyJob(leaf, atlasBuilder, atlasBuilder->reserveItemSlot()));
 					}
 				}
+			}
+		}
+		assert(leafIndexInAtlas == atlasLeafCount);
+
+		return atlas;
+	}
 
-				currentInternalNodeIndex++;
+	void uploadAtlas(PendingAtlas& atlas)
+	{
+		if (!atlas.upload(m_config.grids, m_cacheWriter.get()))
+		{
+			m_cacheWriter.reset(); // removes the partial file
+		}
+		m_uploadedAtlases.push_back(atlas.result);
+	}
+
+	//! Creates renderable nodes for all uploaded atlases, and finishes writing the cache. Call once all atlases have been uploaded.
+	RenderableVolumePtr createVolume()
+	{
+		assert(m_currentInternalNodeIndex == m_topology.getInternalNodeCount());
+		const Grid& firstGrid = *m_config.grids.front();
+
+		if (m_cacheWriter)
+		{
+			CachedVolumeInfo info;
+			for (int i = 0; i < m_config.grids.size(); ++i)
+			{
+				info.gridChannelCounts.push_back(m_config.grids[i]->getChannelCount());
+				info.gridVoxelFormats.push_back(m_config.getVoxelFormat(m_config.grids[i]));
+			}
+			info.lodLevelCount = m_lodLevelCount;
+			info.batchBoxes = m_config.batchBoxes;
+			info.boxSize = m_boxSize;
+			info.maxLeafCountPerInternalNodeDimension = firstGrid.getMaxLeafCountPerInternalNodeDimension();
+			info.voxelCountPerLeafDimension = firstGrid.getVoxelCountPerLeafDimension();
+			info.internalNodeCount = m_topology.getInternalNodeCount();
+
+			try
+			{
+				m_cacheWriter->finish(info, &m_indirectionMap.getData()[0], m_indirectionMap.getData().size());
+			}
+			catch (const std::exception& e)
+			{
+				logCacheWriteFailure(e);
 			}
+			m_cacheWriter.reset();
+		}
+
+		return assembleRenderableVolume(m_config, m_boxSize, firstGrid.getMaxLeafCountPerInternalNodeDimension(), firstGrid.getVoxelCountPerLeafDimension(),
+										createNodeIndirectionTexture(&m_indirectionMap.getData()[0], m_indirectionMap.getData().size()), m_uploadedAtlases);
+	}
+
+private:
+	const RenderableVolumeConfig& m_config;
+	const GridTopology& m_topology;
+	InternalNodesIterator m_internalNodesIterator;
+	int m_currentInternalNodeIndex;
+	NodeIndirectionMap m_indirectionMap;
+	int m_lodLevelCount;
+	glm::vec3 m_boxSize;
+	boost::scoped_ptr<RenderableVolumeCacheWriter> m_cacheWriter;
+	std::vector<UploadedAtlas> m_uploadedAtlases;
+};
 
-			// Atlas is now full. Create textures and meshes.
+RenderableVolumePtr RenderableVolumeFactory::createRenderableVolume(const RenderableVolumeConfig& config)
+{
+	if (config.grids.empty())
+	{
+		return RenderableVolumePtr(new RenderableVolume);
+	}
 
-			if (config.batchBoxes)
+	GridTopology topology;
+	config.grids.front()->buildTopology(topology);
+	if (topology.getInternalNodeCount() == 0)
+	{
+		return RenderableVolumePtr(new RenderableVolume);
+	}
+
+	// Calculate texture atlas sizes
+	std::vector<int> atlasLeafCounts;
+	std::vector<int> atlasInternalNodeCounts = calcAtlasInternalNodeCounts(topology, config.maxLeavesPerAtlas, atlasLeafCounts);
+
+	RenderableVolumeBuilder builder(config, topology);
+
+	PendingAtlasPtr nextAtlas = builder.prepareAtlas(atlasInternalNodeCounts[0], atlasLeafCounts[0]);
+	nextAtlas->fill(config.buildThreadCount);
+
+	// Pipeline atlas builds so that the next atlas fills on worker threads while the current one uploads
+	bool pipelined = (config.buildThreadCount != 1);
+	for (int atlasIndex = 0; atlasIndex < atlasInternalNodeCounts.size(); ++atlasIndex)
+	{
+		PendingAtlasPtr currentAtlas = nextAtlas;
+		nextAtlas.reset();
+
+		boost::scoped_ptr<boost::thread> fillThread;
+		boost::exception_ptr fillException;
+		int nextAtlasIndex = atlasIndex + 1;
+		if (nextAtlasIndex < atlasInternalNodeCounts.size())
+		{
+			nextAtlas = builder.prepareAtlas(atlasInternalNodeCounts[nextAtlasIndex], atlasLeafCounts[nextAtlasIndex]);
+			if (pipelined)
 			{
-				boxMeshes.push_back(boxBatchBuilder.build());
-				boxCenters.push_back(glm::vec3(0,0,0));
+				fillThread.reset(new boost::thread(boost::bind(&fillCapturingException, nextAtlas.get(), config.buildThreadCount, boost::ref(fillException))));
 			}
+		}
 
-			GridTexturesMap textures;
-			for (int i = 0; i < atlasBuilders.size(); ++i)
+		try
+		{
+			builder.uploadAtlas(*currentAtlas);
+		}
+		catch (...)
+		{
+			if (fillThread)
 			{
-				textures[config.grids[i]] = atlasBuilders[i]->build();
+				fillThread->join();
+				if (fillException)
+				{
+					boost::rethrow_exception(fillException);
+				}
 			}
+			throw;
+		}
 
-			for (int i = 0; i < boxMeshes.size(); ++i)
+		if (fillThread)
+		{
+			fillThread->join();
+			if (fillException)
 			{
-				MeshPtr mesh = boxMeshes[i];
+				boost::rethrow_exception(fillException);
+			}
+		}
+		else if (nextAtlas)
+		{
+			nextAtlas->fill(config.buildThreadCount);
+		}
+	}
 
-				SparseVolumeMaterialConfig materialConfig;
-				materialConfig.boxSize = boxSize;
-				materialConfig.leafAtlases = textures;
-				materialConfig.nodeIndirectionTexture = nodeIndirectionTexture;
-				materialConfig.firstInternalNodeIndex = firstInternalNodeIndexInAtlas + i;
-				materialConfig.maxLeafCountPerInternalNodeDimension = config.grids.front()->getMaxLeafCountPerInternalNodeDimension();
-				materialConfig.maxLeafCountPerAtlasDimension = atlasBuilders.front()->getMaxItemCountPerDimension();
+	return builder.createVolume();
+}
 
-				MaterialPtr material = config.materialFactory->createMaterial(materialConfig);
+RenderableVolumePtr RenderableVolumeFactory::loadRenderableVolume(const std::string& cacheFilename, const RenderableVolumeConfig& config)
+{
+	RenderableVolumeCacheReader reader(cacheFilename);
+	const CachedVolumeInfo& info = reader.getInfo();
+
+	if (info.gridChannelCounts.size() != config.grids.size())
+	{
+		throw std::runtime_error("Cache file grid count does not match config: " + cacheFilename);
+	}
+	for (int i = 0; i < config.grids.size(); ++i)
+	{
+		if (info.gridChannelCounts[i] != config.grids[i]->getChannelCount())
+		{
+			throw std::runtime_error("Cache file grid channel count does not match config: " + cacheFilename);
+		}
+		if (info.gridVoxelFormats[i] != config.getVoxelFormat(config.grids[i]))
+		{
+			throw std::runtime_error("Cache file grid voxel format does not match config: " + cacheFilename);
+		}
+	}
+	if (info.batchBoxes != config.batchBoxes)
+	{
+		throw std::runtime_error("Cache file box batching does not match config: " + cacheFilename);
+	}
 
-				GeoPtr geo(new Geo(mesh, material));
+	// Upload straight from the file mapping
+	std::vector<UploadedAtlas> atlases;
+	const std::vector<CachedAtlas>& cachedAtlases = reader.getAtlases();
+	for (int a = 0; a < cachedAtlases.size(); ++a)
+	{
+		const CachedAtlas& cachedAtlas = cachedAtlases[a];
+
+		UploadedAtlas atlas;
+		atlas.firstInternalNodeIndex = cachedAtlas.firstInternalNodeIndex;
+		atlas.boxCenters = cachedAtlas.boxCenters;
+		atlas.lodMaxLeafCountPerAtlasDimension = cachedAtlas.lodMaxLeafCountPerAtlasDimension;
+		atlas.lodTextures.resize(cachedAtlas.lodImages.size());
+
+		for (int lod = 0; lod < cachedAtlas.lodImages.size(); ++lod)
+		{
+			for (int i = 0; i < config.grids.size(); ++i)
+			{
+				const CachedAtlasImage& image = cachedAtlas.lodImages[lod][i];
+				if (image.sizeBytes != getImageSizeBytes(image.width, image.height, image.depth, image.format))
+				{
+					throw std::runtime_error("Cache file image size is inconsistent: " + cacheFilename);
+				}
 
-				RenderableNodePtr node(new RenderableNode);
-				node->addRenderable(geo);
-				node->setPosition(boxCenters[i]);
-				outputVolume->nodes.push_back(node);
+				ImageTextureConfig textureConfig = VolumeTextureAtlasBuilder::createAtlasTextureConfig(image.format, image.width, image.height, image.depth, image.data);
+				atlas.lodTextures[lod][config.grids[i]] = TexturePtr(new Texture(textureConfig));
 			}
 		}
+		atlases.push_back(atlas);
+	}
+
+	int maxLeafCountPerInternalNode = info.maxLeafCountPerInternalNodeDimension * info.maxLeafCountPerInternalNodeDimension * info.maxLeafCountPerInternalNodeDimension;
+	if (reader.getIndirectionCount() < (size_t)info.internalNodeCount * NodeIndirectionMap::getHeaderSize(maxLeafCountPerInternalNode))
+	{
+		throw std::runtime_error("Cache file indirection size is inconsistent: " + cacheFilename);
 	}
-	return outputVolume;
+	TexturePtr nodeIndirectionTexture = createNodeIndirectionTexture(reader.getIndirectionData(), reader.getIndirectionCount());
+
+	return assembleRenderableVolume(config, info.boxSize, info.maxLeafCountPerInternalNodeDimension, info.voxelCountPerLeafDimension, nodeIndirectionTexture, atlases);
 }
 
 } // namespace GSparseVolumes
@@ -21,30 +21,51 @@
 #pragma once
 
 #include "GSparseVolumesFwd.h"
+#include "VolumeTextureAtlasBuilder.h"
 #include <GVis/GVisFwd.h>
 #include <GVis/Math.h>
 
 #include <map>
+#include <string>
 
 namespace GSparseVolumes {
 
 typedef std::map<GridPtr, GVis::TexturePtr> GridTexturesMap;
+typedef std::map<GridPtr, VoxelFormat> GridVoxelFormatsMap;
 
 struct SparseVolumeMaterialConfig
 {
+	SparseVolumeMaterialConfig() :
+		lodLevel(0)
+	{
+	}
+
 	glm::vec3 boxSize;
 
 	//! Texture atlas for each grid
 	GridTexturesMap leafAtlases;
 
-	//! 1D texture which maps {internalNodeIndex * maxLeafCountPerInternalNode + leafIndexInInternalNode} to {leafIndexInAtlas}
+	//! Storage format of each grid's atlas. Grids not in the map use VoxelFormat_UNorm8.
+	//! Factories must choose shaders which match: block compressed atlases are 2d array textures,
+	//! and VoxelFormat_BC5 atlases hold octahedral encoded normals.
+	GridVoxelFormatsMap leafAtlasFormats;
+
+	//! Texture buffer which maps {internalNodeIndex, leafIndexInInternalNode} to {leafIndexInAtlas}. See NodeIndirectionMap for the layout.
 	GVis::TexturePtr nodeIndirectionTexture;
 
 	//! Index of the first InternalNode in the geometry with this material assigned
 	int firstInternalNodeIndex;
 
 	int maxLeafCountPerInternalNodeDimension;
+
+	//! Number of leaf slots along each dimension of the atlases. Need not be a power of two.
 	glm::ivec3 maxLeafCountPerAtlasDimension;
+
+	//! Number of voxels along each dimension of a leaf in the atlases
+	int leafVoxelCountPerDimension;
+
+	//! 0 is full resolution. Each level halves atlas resolution, so the raymarch step size can be doubled.
+	int lodLevel;
 };
 
 class SparseVolumeMaterialFactory
@@ -57,17 +78,59 @@ public:
 
 typedef shared_ptr<SparseVolumeMaterialFactory> SparseVolumeMaterialFactoryPtr;
 
+//! Boxes of one atlas drawn by a single instanced draw call
+struct InstancedBoxes
+{
+	//! Index of the node and geo in RenderableVolume
+	int nodeIndex;
+
+	GVis::MeshPtr mesh;
+
+	//! Index of the per instance attribute in mesh
+	int instanceAttributeIndex;
+
+	//! Per instance data in draw order. xyz is the box center relative to the node.
+	//! w is the index of the box's InternalNode relative to the material's firstInternalNodeIndex.
+	std::vector<glm::vec4> instances;
+};
+
 struct RenderableVolume
 {
 	std::vector<GVis::RenderableNodePtr> nodes;
+
+	//! Box geo of each node, in the same order as nodes
+	std::vector<GVis::GeoPtr> geos;
+
+	//! Material for each LOD level of each node, indexed by [node][lodLevel]
+	std::vector<std::vector<GVis::MaterialPtr> > lodMaterials;
+
+	//! Center of the region covered by each node's boxes, relative to the node position
+	std::vector<glm::vec3> boundsCenters;
+
+	//! Half size of the region covered by each node's boxes
+	std::vector<glm::vec3> boundsHalfSizes;
+
+	//! Size of one InternalNode box
+	glm::vec3 internalNodeBoxSize;
+
+	//! Number of voxels along each dimension of an InternalNode at full resolution
+	int voxelCountPerInternalNodeDimension;
+
+	//! Filled if RenderableVolumeConfig::instanceBoxes was set
+	std::vector<InstancedBoxes> instancedBoxes;
 };
 
 struct RenderableVolumeConfig
 {
 	RenderableVolumeConfig() :
 		scale(1.0f),
+		offset(0,0,0),
 		maxLeavesPerAtlas(4096),
-		batchBoxes(false)
+		batchBoxes(false),
+		instanceBoxes(false),
+		atlasPackingMode(AtlasPackingMode_Tight),
+		buildThreadCount(0),
+		lodLevelCount(1)
 	{
 	}
 
@@ -88,8 +151,48 @@ struct RenderableVolumeConfig
 	*/
 	bool batchBoxes;
 
+	/*! When batchBoxes is false, draws the boxes of each atlas with one instanced draw call instead of one draw call per internal node.
+		Instances can be sorted for transparency with VolumeInstanceSorter.
+		Materials must use a shader which offsets box vertices by the per instance data at attribute location 2 (see InstancedBoxes).
+	*/
+	bool instanceBoxes;
+
 	float scale;
+
+	//! Added to InternalNode box centers after scaling
+	glm::vec3 offset;
+
 	int maxLeavesPerAtlas;
+
+	//! With AtlasPackingMode_Tight, each atlas is sized for the leaves it contains rather than maxLeavesPerAtlas
+	AtlasPackingMode atlasPackingMode;
+
+	//! Atlas storage format for each grid. Grids not in the map use VoxelFormat_UNorm8.
+	GridVoxelFormatsMap voxelFormats;
+
+	VoxelFormat getVoxelFormat(const GridPtr& grid) const
+	{
+		GridVoxelFormatsMap::const_iterator i = voxelFormats.find(grid);
+		return (i == voxelFormats.end()) ? VoxelFormat_UNorm8 : i->second;
+	}
+
+	/*! Number of threads used to copy leaves into texture atlases.
+		0 uses all hardware threads. 1 builds on the calling thread.
+		Leaf::toImageBuffer must be thread safe when more than one thread is used.
+	*/
+	int buildThreadCount;
+
+	/*! Number of atlas resolutions to build, including full resolution.
+		Level n atlases store leaves box filtered down by 2^n along each dimension.
+		Clamped so that leaves are at least one voxel wide, or four voxels wide for block compressed formats.
+		Use VolumeLodSelector to switch between levels at render time.
+	*/
+	int lodLevelCount;
+
+	/*! When not empty, the finished atlases and indirection map are also written to this file for RenderableVolumeFactory::loadRenderableVolume.
+		Writing is best-effort: if the file can't be written, the failure is logged and the volume is still built.
+	*/
+	std::string cacheFilename;
 };
 
 /*!
@@ -97,11 +200,22 @@ A RenderableVolume consists of one or more renderable box meshes, each box corre
 Each box will be assigned a material with the following resources:
  - atlases containing packed leaf nodes from grid
  - Indirection texture which maps leaf node ID to coordinate of leaf in texture atlas
+When config.lodLevelCount is greater than 1, a material is also created for each lower resolution level.
+All levels share the indirection texture because leaves occupy the same slot index in every level's atlas.
 */
 class RenderableVolumeFactory
 {
 public:
 	static RenderableVolumePtr createRenderableVolume(const RenderableVolumeConfig& config);
+
+	/*! Creates a RenderableVolume from a file written via RenderableVolumeConfig::cacheFilename, without reading any leaves.
+		Textures are uploaded directly from a memory mapping of the file.
+		config.grids are only used as atlas keys in materials, so may be empty grids,
+		but must match the count and channel counts of the grids the cache was built from.
+		config.scale, offset and lodLevelCount are ignored because they are baked into the cache. config.voxelFormats must match the cache.
+		@throws std::runtime_error if the file is missing, corrupt or does not match config.
+	*/
+	static RenderableVolumePtr loadRenderableVolume(const std::string& cacheFilename, const RenderableVolumeConfig& config);
 };
 
 } // namespace GSparseVolumes
\ No newline at end of file
@@ -0,0 +1,92 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "VolumeInstanceSorter.h"
+#include "RenderableVolumeFactory.h"
+
+#include <GVis/Camera.h>
+#include <GVis/Mesh.h>
+#include <GVis/RenderableNode.h>
+
+#include <algorithm>
+
+using namespace GVis;
+
+namespace GSparseVolumes {
+
+VolumeInstanceSorter::VolumeInstanceSorter(const RenderableVolumePtr& volume) :
+	m_volume(volume)
+{
+	for (int i = 0; i < m_volume->instancedBoxes.size(); ++i)
+	{
+		const std::vector<glm::vec4>& instances = m_volume->instancedBoxes[i].instances;
+		m_unsortedInstances.push_back(instances);
+
+		m_orders.push_back(std::vector<int>(instances.size()));
+		for (int j = 0; j < instances.size(); ++j)
+		{
+			m_orders.back()[j] = j;
+		}
+	}
+}
+
+void VolumeInstanceSorter::update(const Camera& camera)
+{
+	glm::vec4 cameraPosition(camera.getPosition(), 1.0f);
+
+	for (int i = 0; i < m_volume->instancedBoxes.size(); ++i)
+	{
+		InstancedBoxes& boxes = m_volume->instancedBoxes[i];
+		const std::vector<glm::vec4>& unsortedInstances = m_unsortedInstances[i];
+		std::vector<int>& order = m_orders[i];
+
+		// Sort in node space, farthest first
+		glm::vec3 cameraPosition_nodeSpace(m_volume->nodes[boxes.nodeIndex]->getInverseTransform() * cameraPosition);
+
+		m_sortKeys.resize(unsortedInstances.size());
+		for (int j = 0; j < unsortedInstances.size(); ++j)
+		{
+			glm::vec3 offset = glm::vec3(unsortedInstances[j]) - cameraPosition_nodeSpace;
+			m_sortKeys[j] = std::make_pair(-glm::dot(offset, offset), j);
+		}
+		std::sort(m_sortKeys.begin(), m_sortKeys.end());
+
+		bool changed = false;
+		for (int j = 0; j < m_sortKeys.size(); ++j)
+		{
+			if (order[j] != m_sortKeys[j].second)
+			{
+				order[j] = m_sortKeys[j].second;
+				changed = true;
+			}
+		}
+
+		if (changed)
+		{
+			for (int j = 0; j < order.size(); ++j)
+			{
+				boxes.instances[j] = unsortedInstances[order[j]];
+			}
+			boxes.mesh->updateVertexAttribute(boxes.instanceAttributeIndex, (GLfloat&)boxes.instances[0], (int)boxes.instances.size() * sizeof(glm::vec4));
+		}
+	}
+}
+
+} // namespace GSparseVolumes
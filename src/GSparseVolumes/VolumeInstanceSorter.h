@@ -0,0 +1,53 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "GSparseVolumesFwd.h"
+
+#include <GVis/GVisFwd.h>
+#include <GVis/Math.h>
+
+#include <utility>
+#include <vector>
+
+namespace GSparseVolumes {
+
+/*!
+Sorts the instances of a RenderableVolume's instanced boxes back to front, so that transparent volumes blend correctly.
+Instances are only re-uploaded when their order changes.
+Nodes themselves are sorted by the render queue, so only the boxes within each node need sorting here.
+*/
+class VolumeInstanceSorter
+{
+public:
+	explicit VolumeInstanceSorter(const RenderableVolumePtr& volume);
+
+	//! Call once per frame before rendering
+	void update(const GVis::Camera& camera);
+
+private:
+	RenderableVolumePtr m_volume;
+	std::vector<std::pair<float, int> > m_sortKeys; //!< Reused across updates
+	std::vector<std::vector<int> > m_orders; //!< Current draw order of each InstancedBoxes, as indices into its unsorted instances
+	std::vector<std::vector<glm::vec4> > m_unsortedInstances;
+};
+
+} // namespace GSparseVolumes
@@ -0,0 +1,85 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "VolumeLodSelector.h"
+#include "RenderableVolumeFactory.h"
+
+#include <GVis/Camera.h>
+#include <GVis/Geo.h>
+#include <GVis/RenderableNode.h>
+
+#include <algorithm>
+
+using namespace GVis;
+
+namespace GSparseVolumes {
+
+VolumeLodSelector::VolumeLodSelector(const RenderableVolumePtr& volume, float lodBias) :
+	m_volume(volume),
+	m_lodLevels(volume->nodes.size(), 0),
+	m_lodBias(lodBias)
+{
+	assert(m_volume->geos.size() == m_volume->nodes.size());
+	assert(m_volume->lodMaterials.size() == m_volume->nodes.size());
+}
+
+void VolumeLodSelector::update(const Camera& camera, int viewportHeight)
+{
+	const glm::mat4& projection = camera.getProjection()->getMatrix();
+	glm::vec3 cameraPosition = camera.getPosition();
+
+	// Pixels covered by one world unit at unit distance (perspective) or at any distance (orthographic)
+	float pixelsPerUnit = projection[1][1] * 0.5f * viewportHeight;
+	bool perspective = (projection[3][3] == 0.0f);
+
+	float internalNodeSize = std::max(m_volume->internalNodeBoxSize.x, std::max(m_volume->internalNodeBoxSize.y, m_volume->internalNodeBoxSize.z));
+	float voxelCount = (float)m_volume->voxelCountPerInternalNodeDimension;
+
+	for (int i = 0; i < m_volume->nodes.size(); ++i)
+	{
+		int lodLevelCount = (int)m_volume->lodMaterials[i].size();
+		if (lodLevelCount <= 1)
+		{
+			continue;
+		}
+
+		float projectedSize = internalNodeSize * pixelsPerUnit;
+		if (perspective)
+		{
+			// Distance to the nearest point of the node's bounds
+			glm::vec3 center = m_volume->nodes[i]->getPosition() + m_volume->boundsCenters[i];
+			glm::vec3 offset = glm::max(glm::abs(cameraPosition - center) - m_volume->boundsHalfSizes[i], glm::vec3(0,0,0));
+			projectedSize /= std::max(glm::length(offset), 1e-6f);
+		}
+
+		// Each level halves the voxel count, so pick the coarsest level which still has a voxel per pixel
+		float voxelsPerPixel = voxelCount / std::max(projectedSize * m_lodBias, 1e-6f);
+		int lodLevel = (voxelsPerPixel > 1.0f) ? (int)floor(log(voxelsPerPixel) / log(2.0f)) : 0;
+		lodLevel = std::min(lodLevel, lodLevelCount - 1);
+
+		if (lodLevel != m_lodLevels[i])
+		{
+			m_lodLevels[i] = lodLevel;
+			m_volume->geos[i]->setMaterial(m_volume->lodMaterials[i][lodLevel]);
+		}
+	}
+}
+
+} // namespace GSparseVolumes
@@ -0,0 +1,53 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "GSparseVolumesFwd.h"
+
+#include <GVis/GVisFwd.h>
+
+#include <vector>
+
+namespace GSparseVolumes {
+
+/*!
+Switches the materials of a RenderableVolume between the LOD levels built by RenderableVolumeFactory.
+The level for each node is chosen so that roughly one voxel is raymarched per pixel covered by an InternalNode.
+*/
+class VolumeLodSelector
+{
+public:
+	//! @param lodBias values greater than 1 select higher resolution levels
+	explicit VolumeLodSelector(const RenderableVolumePtr& volume, float lodBias = 1.0f);
+
+	//! Selects the LOD level of each node from its projected size. Call once per frame before rendering.
+	//! @param viewportHeight in pixels
+	void update(const GVis::Camera& camera, int viewportHeight);
+
+	int getLodLevel(int nodeIndex) const {return m_lodLevels[nodeIndex];}
+
+private:
+	RenderableVolumePtr m_volume;
+	std::vector<int> m_lodLevels;
+	float m_lodBias;
+};
+
+} // namespace GSparseVolumes
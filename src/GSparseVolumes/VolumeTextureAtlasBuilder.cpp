@@ -22,8 +22,10 @@
 #include "Leaf.h"
 
 #include <GVis/Texture.h>
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
+#include <vector>
 
 using namespace GSparseVolumes;
 using namespace GVis;
@@ -42,26 +44,90 @@ static unsigned int roundUpToNearestPowerOfTwo(unsigned int v)
 	return v;
 }
 
-VolumeTextureAtlasBuilder::VolumeTextureAtlasBuilder(int maxItemCount, int itemTextureWidth, int channelCount) :
+//! Returns the smallest item count per dimension which holds itemCount items with no dimension exceeding maxItemCountPerDimension.
+//! Where volumes are equal, the layout closest to a cube is chosen.
+static glm::ivec3 calcTightItemCountPerDimension(int itemCount, int maxItemCountPerDimension)
+{
+	glm::ivec3 best(0,0,0);
+	size_t bestVolume = 0;
+	int bestMaxDimension = 0;
+
+	for (int x = 1; x <= maxItemCountPerDimension; ++x)
+	{
+		for (int y = 1; y <= maxItemCountPerDimension; ++y)
+		{
+			int z = (itemCount + x * y - 1) / (x * y);
+			if (z > maxItemCountPerDimension)
+			{
+				continue;
+			}
+
+			size_t volume = (size_t)x * (size_t)y * (size_t)z;
+			int maxDimension = std::max(x, std::max(y, z));
+			if (bestVolume == 0 || volume < bestVolume || (volume == bestVolume && maxDimension < bestMaxDimension))
+			{
+				best = glm::ivec3(x, y, z);
+				bestVolume = volume;
+				bestMaxDimension = maxDimension;
+			}
+
+			if (z == 1)
+			{
+				break; // larger y only adds empty space
+			}
+		}
+	}
+
+	if (bestVolume == 0)
+	{
+		throw std::runtime_error("Texture atlas item count exceeds maximum 3d texture size");
+	}
+	return best;
+}
+
+VolumeTextureAtlasBuilder::VolumeTextureAtlasBuilder(int maxItemCount, int itemTextureWidth, int channelCount,
+													 AtlasPackingMode packingMode, VoxelFormat voxelFormat) :
+	m_voxelFormat(voxelFormat),
 	m_itemCount(0),
 	m_itemTextureWidth(itemTextureWidth)
 {
 	assert(maxItemCount > 0);
+	toPixelFormat(voxelFormat, channelCount); // throws if channelCount is not supported
 
-	m_maxItemCountPerDimension.x = ceil(pow((double)maxItemCount, 1.0 / 3.0));
-	m_maxItemCountPerDimension.x = roundUpToNearestPowerOfTwo(m_maxItemCountPerDimension.x);
+	if (packingMode == AtlasPackingMode_Tight)
+	{
+		m_maxItemCountPerDimension = calcTightItemCountPerDimension(maxItemCount, getMax3dTextureSize() / itemTextureWidth);
+	}
+	else
+	{
+		m_maxItemCountPerDimension.x = ceil(pow((double)maxItemCount, 1.0 / 3.0));
+		m_maxItemCountPerDimension.x = roundUpToNearestPowerOfTwo(m_maxItemCountPerDimension.x);
+
+		m_maxItemCountPerDimension.y = ceil(sqrt((double)maxItemCount / (double)m_maxItemCountPerDimension.x));
+		m_maxItemCountPerDimension.y = roundUpToNearestPowerOfTwo(m_maxItemCountPerDimension.y);
 
-	m_maxItemCountPerDimension.y = ceil(sqrt((double)maxItemCount / (double)m_maxItemCountPerDimension.x));
-	m_maxItemCountPerDimension.y = roundUpToNearestPowerOfTwo(m_maxItemCountPerDimension.y);
+		m_maxItemCountPerDimension.z = ceil((double)maxItemCount / (double)(m_maxItemCountPerDimension.x * m_maxItemCountPerDimension.y));
+		m_maxItemCountPerDimension.z = roundUpToNearestPowerOfTwo(m_maxItemCountPerDimension.z);
+	}
 
-	m_maxItemCountPerDimension.z = ceil((double)maxItemCount / (double)(m_maxItemCountPerDimension.x * m_maxItemCountPerDimension.y));
-	m_maxItemCountPerDimension.z = roundUpToNearestPowerOfTwo(m_maxItemCountPerDimension.z);
+	if (isSixteenBitVoxelFormat(m_voxelFormat))
+	{
+		createImageBuffer(m_imageBuffer16, channelCount);
+	}
+	else
+	{
+		createImageBuffer(m_imageBuffer, channelCount);
+	}
+}
 
-	m_imageBuffer.reset(new ImageBufferUChar(m_maxItemCountPerDimension.x * itemTextureWidth,
-												m_maxItemCountPerDimension.y * itemTextureWidth,
-												m_maxItemCountPerDimension.z * itemTextureWidth, channelCount));
+template <typename T>
+void VolumeTextureAtlasBuilder::createImageBuffer(boost::scoped_ptr<ImageBuffer<T> >& buffer, int channelCount)
+{
+	buffer.reset(new ImageBuffer<T>(m_maxItemCountPerDimension.x * m_itemTextureWidth,
+									m_maxItemCountPerDimension.y * m_itemTextureWidth,
+									m_maxItemCountPerDimension.z * m_itemTextureWidth, channelCount));
 
-	memset(m_imageBuffer->data, 0, m_imageBuffer->getSizeInBytes());
+	memset(buffer->data, 0, buffer->getSizeInBytes());
 }
 
 VolumeTextureAtlasBuilder::~VolumeTextureAtlasBuilder()
@@ -69,46 +135,172 @@ VolumeTextureAtlasBuilder::~VolumeTextureAtlasBuilder()
 }
 
 TexturePtr VolumeTextureAtlasBuilder::build() const
+{
+	std::vector<unsigned char> compressedData;
+	return TexturePtr(new Texture(getTextureConfig(compressedData)));
+}
+
+ImageTextureConfig VolumeTextureAtlasBuilder::getTextureConfig(std::vector<unsigned char>& compressedData) const
+{
+	if (m_imageBuffer16)
+	{
+		return createAtlasTextureConfig(toPixelFormat(m_voxelFormat, m_imageBuffer16->channelCount), m_imageBuffer16->width, m_imageBuffer16->height, m_imageBuffer16->depth,
+										reinterpret_cast<unsigned char*>(m_imageBuffer16->data));
+	}
+
+	const unsigned char* data = m_imageBuffer->data;
+	if (isBlockCompressedVoxelFormat(m_voxelFormat))
+	{
+		compressedData = compressImage(*m_imageBuffer, m_voxelFormat);
+		data = &compressedData[0];
+	}
+
+	return createAtlasTextureConfig(toPixelFormat(m_voxelFormat, m_imageBuffer->channelCount), m_imageBuffer->width, m_imageBuffer->height, m_imageBuffer->depth, data);
+}
+
+ImageTextureConfig VolumeTextureAtlasBuilder::createAtlasTextureConfig(PixelFormat format, int width, int height, int depth, const unsigned char* data)
 {
 	ImageTextureConfig textureConfig = ImageTextureConfig::createDefault();
-	textureConfig.width = m_imageBuffer->width;
-	textureConfig.height = m_imageBuffer->height;
-	textureConfig.depth = m_imageBuffer->depth;
 	textureConfig.is3d = true;
-	textureConfig.manualMipmapCount = 0;
-			
-	if (m_imageBuffer->channelCount == 1)
+	textureConfig.is2dArray = (format == PixelFormat_BC4 || format == PixelFormat_BC5); // RGTC is not defined for 3d textures
+	textureConfig.manualMipmapCount = 1; // raymarching samples a single level
+	textureConfig.filter = TextureFilter_Bilinear;
+	textureConfig.textureAddressMode = TextureAddressMode_Clamp;
+	textureConfig.width = width;
+	textureConfig.height = height;
+	textureConfig.depth = depth;
+	textureConfig.format = format;
+	textureConfig.data = const_cast<unsigned char*>(data); // only read by Texture
+	return textureConfig;
+}
+
+void VolumeTextureAtlasBuilder::addTexture(const Leaf& leaf)
+{
+	fillItemSlot(leaf, reserveItemSlot());
+}
+
+glm::ivec3 VolumeTextureAtlasBuilder::reserveItemSlot()
+{
+	int x = m_itemCount % m_maxItemCountPerDimension.x;
+	int y = (m_itemCount / m_maxItemCountPerDimension.x) % m_maxItemCountPerDimension.y;
+	int z = m_itemCount / (m_maxItemCountPerDimension.x * m_maxItemCountPerDimension.y);
+	assert(z < m_maxItemCountPerDimension.z);
+
+	++m_itemCount;
+	return glm::ivec3(x * m_itemTextureWidth, y * m_itemTextureWidth, z * m_itemTextureWidth);
+}
+
+//! Averages each factor^3 block of src into one voxel of dest, where factor = src.width / dest.width
+static void downsampleBox(const ImageBufferFloat& src, ImageBufferFloat& dest)
+{
+	assert(src.width % dest.width == 0);
+	assert(src.channelCount == dest.channelCount);
+	int factor = src.width / dest.width;
+	int channelCount = src.channelCount;
+	float oneOnSampleCount = 1.0f / float(factor * factor * factor);
+
+	ImageBufferFloat& mutableSrc = const_cast<ImageBufferFloat&>(src);
+	for (int z = 0; z < dest.depth; ++z)
 	{
-		textureConfig.format = PixelFormat_R8;
+		for (int y = 0; y < dest.height; ++y)
+		{
+			for (int x = 0; x < dest.width; ++x)
+			{
+				float* result = dest.getElement(x, y, z);
+				for (int c = 0; c < channelCount; ++c)
+				{
+					result[c] = 0;
+				}
+
+				for (int sz = 0; sz < factor; ++sz)
+				{
+					for (int sy = 0; sy < factor; ++sy)
+					{
+						const float* sample = mutableSrc.getElement(x * factor, y * factor + sy, z * factor + sz);
+						for (int i = 0; i < factor * channelCount; ++i)
+						{
+							result[i % channelCount] += sample[i];
+						}
+					}
+				}
+
+				for (int c = 0; c < channelCount; ++c)
+				{
+					result[c] *= oneOnSampleCount;
+				}
+			}
+		}
 	}
-	else if (m_imageBuffer->channelCount == 3)
+}
+
+static void convertRowUNorm8(unsigned char* dest, const float* src, int count)
+{
+	for (int i = 0; i < count; ++i)
 	{
-		textureConfig.format = PixelFormat_RGB8;
+		dest[i] = (unsigned char)(std::min(std::max(src[i], 0.0f), 1.0f) * 255.0f + 0.5f);
 	}
-	else if (m_imageBuffer->channelCount == 4)
+}
+
+static void convertRowUNorm16(unsigned short* dest, const float* src, int count)
+{
+	for (int i = 0; i < count; ++i)
 	{
-		textureConfig.format = PixelFormat_RGBA8;
+		dest[i] = (unsigned short)(std::min(std::max(src[i], 0.0f), 1.0f) * 65535.0f + 0.5f);
 	}
-	else
+}
+
+static void convertRowFloat16(unsigned short* dest, const float* src, int count)
+{
+	for (int i = 0; i < count; ++i)
 	{
-		throw std::runtime_error("Image format is unsupported");
+		dest[i] = floatToHalf(src[i]);
 	}
-			
-			
-	textureConfig.textureAddressMode = TextureAddressMode_Clamp;
-	textureConfig.data = m_imageBuffer->data;
-	
-	return TexturePtr(new Texture(textureConfig));
 }
 
-void VolumeTextureAtlasBuilder::addTexture(const Leaf& leaf)
+template <typename T>
+static void copyToSlot(ImageBuffer<T>& dest, const glm::ivec3& slotOffset, const ImageBufferFloat& src, void (*convertRow)(T*, const float*, int))
 {
-	int x = m_itemCount % m_maxItemCountPerDimension.x;
-	int y = (m_itemCount / m_maxItemCountPerDimension.x) % m_maxItemCountPerDimension.y;
-	int z = m_itemCount / (m_maxItemCountPerDimension.x * m_maxItemCountPerDimension.y);
+	int rowValueCount = src.width * src.channelCount;
+	for (int z = 0; z < src.depth; ++z)
+	{
+		for (int y = 0; y < src.height; ++y)
+		{
+			const float* srcRow = const_cast<ImageBufferFloat&>(src).getElement(0, y, z);
+			convertRow(dest.getElement(slotOffset.x, slotOffset.y + y, slotOffset.z + z), srcRow, rowValueCount);
+		}
+	}
+}
 
-	assert(leaf.getVoxelCountPerDimension() == m_itemTextureWidth);
-	leaf.toImageBuffer(*m_imageBuffer, glm::ivec3(x * m_itemTextureWidth, y * m_itemTextureWidth, z * m_itemTextureWidth));
+void VolumeTextureAtlasBuilder::fillItemSlot(const Leaf& leaf, const glm::ivec3& slotOffset)
+{
+	int leafWidth = leaf.getVoxelCountPerDimension();
+	assert(leafWidth % m_itemTextureWidth == 0);
 
-	++m_itemCount;
+	if (!m_imageBuffer16 && leafWidth == m_itemTextureWidth)
+	{
+		leaf.toImageBuffer(*m_imageBuffer, slotOffset);
+		return;
+	}
+
+	// Read leaf at full precision, box filter down to the item width if needed, then convert to the atlas format
+	int channelCount = m_imageBuffer16 ? m_imageBuffer16->channelCount : m_imageBuffer->channelCount;
+	ImageBufferFloat leafBuffer(leafWidth, leafWidth, leafWidth, channelCount);
+	leaf.toImageBuffer(leafBuffer, glm::ivec3(0,0,0));
+
+	boost::scoped_ptr<ImageBufferFloat> downsampledBuffer;
+	if (leafWidth != m_itemTextureWidth)
+	{
+		downsampledBuffer.reset(new ImageBufferFloat(m_itemTextureWidth, m_itemTextureWidth, m_itemTextureWidth, channelCount));
+		downsampleBox(leafBuffer, *downsampledBuffer);
+	}
+	const ImageBufferFloat& itemBuffer = downsampledBuffer ? *downsampledBuffer : leafBuffer;
+
+	if (m_imageBuffer16)
+	{
+		copyToSlot(*m_imageBuffer16, slotOffset, itemBuffer, (m_voxelFormat == VoxelFormat_Float16) ? convertRowFloat16 : convertRowUNorm16);
+	}
+	else
+	{
+		copyToSlot(*m_imageBuffer, slotOffset, itemBuffer, convertRowUNorm8);
+	}
 }
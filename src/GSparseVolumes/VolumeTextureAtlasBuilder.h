@@ -22,6 +22,7 @@
 
 #include "ImageBuffer.h"
 #include "GSparseVolumesFwd.h"
+#include "VoxelFormat.h"
 
 #include <boost/scoped_ptr.hpp>
 
@@ -30,20 +31,54 @@
 
 namespace GSparseVolumes {
 
+enum AtlasPackingMode
+{
+	//! Each atlas dimension is rounded up to a power of two
+	AtlasPackingMode_PowerOfTwo,
+
+	//! Smallest non-power-of-two layout that holds maxItemCount items within GL_MAX_3D_TEXTURE_SIZE
+	AtlasPackingMode_Tight
+};
+
 class VolumeTextureAtlasBuilder
 {
 public:
-	VolumeTextureAtlasBuilder(int maxItemCount, int itemTextureWidth, int channelCount);
+	VolumeTextureAtlasBuilder(int maxItemCount, int itemTextureWidth, int channelCount,
+							  AtlasPackingMode packingMode = AtlasPackingMode_PowerOfTwo, VoxelFormat voxelFormat = VoxelFormat_UNorm8);
 	~VolumeTextureAtlasBuilder();
 
 	void addTexture(const Leaf& leaf);
 
+	//! Reserves the next free item slot in the atlas without filling it.
+	//! @return voxel offset of the slot within the atlas image buffer
+	glm::ivec3 reserveItemSlot();
+
+	/*! Fills a slot returned by reserveItemSlot(). Different slots may be filled concurrently from multiple threads.
+		If the leaf is wider than the item texture width, it is box filtered down to fit. The leaf width must be a multiple of the item width.
+	*/
+	void fillItemSlot(const Leaf& leaf, const glm::ivec3& slotOffset);
+
 	GVis::TexturePtr build() const;
 
+	/*! Returns the texture config used by build().
+		config.data points into this builder, or into compressedData for block compressed formats.
+	*/
+	GVis::ImageTextureConfig getTextureConfig(std::vector<unsigned char>& compressedData) const;
+
+	//! Returns config for an atlas texture holding data, which must be in the layout expected by format.
+	//! Atlases are 3d textures, except for block compressed formats which are 2d array textures with one layer per voxel slice.
+	static GVis::ImageTextureConfig createAtlasTextureConfig(GVis::PixelFormat format, int width, int height, int depth, const unsigned char* data);
+
 	glm::ivec3 getMaxItemCountPerDimension() const {return m_maxItemCountPerDimension;}
 
 private:
-	boost::scoped_ptr<ImageBufferUChar> m_imageBuffer;
+	template <typename T>
+	void createImageBuffer(boost::scoped_ptr<ImageBuffer<T> >& buffer, int channelCount);
+
+private:
+	VoxelFormat m_voxelFormat;
+	boost::scoped_ptr<ImageBufferUChar> m_imageBuffer; //!< Used by 8 bit and block compressed formats
+	boost::scoped_ptr<ImageBufferUShort> m_imageBuffer16; //!< Used by 16 bit formats
 	int m_itemCount;
 	glm::ivec3 m_maxItemCountPerDimension;
 	int m_itemTextureWidth;
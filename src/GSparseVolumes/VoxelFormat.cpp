@@ -0,0 +1,224 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "VoxelFormat.h"
+
+#include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace GVis;
+
+namespace GSparseVolumes {
+
+PixelFormat toPixelFormat(VoxelFormat format, int channelCount)
+{
+	switch (format)
+	{
+	case VoxelFormat_UNorm8:
+		if (channelCount == 1) return PixelFormat_R8;
+		if (channelCount == 3) return PixelFormat_RGB8;
+		if (channelCount == 4) return PixelFormat_RGBA8;
+		break;
+	case VoxelFormat_UNorm16:
+		if (channelCount == 1) return PixelFormat_R16;
+		break;
+	case VoxelFormat_Float16:
+		if (channelCount == 1) return PixelFormat_R16F;
+		break;
+	case VoxelFormat_BC4:
+		if (channelCount == 1) return PixelFormat_BC4;
+		break;
+	case VoxelFormat_BC5:
+		if (channelCount == 3) return PixelFormat_BC5;
+		break;
+	}
+	throw std::runtime_error("Voxel format " + boost::lexical_cast<std::string>(format) + " does not support "
+							 + boost::lexical_cast<std::string>(channelCount) + " channels");
+}
+
+bool isSixteenBitVoxelFormat(VoxelFormat format)
+{
+	return format == VoxelFormat_UNorm16 || format == VoxelFormat_Float16;
+}
+
+bool isBlockCompressedVoxelFormat(VoxelFormat format)
+{
+	return format == VoxelFormat_BC4 || format == VoxelFormat_BC5;
+}
+
+unsigned short floatToHalf(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	unsigned int sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+	unsigned int mantissa = bits & 0x007fffff;
+
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+		{
+			return (unsigned short)sign; // too small, flush to zero
+		}
+		// denormal
+		mantissa |= 0x00800000;
+		int shift = 14 - exponent;
+		unsigned int halfMantissa = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1) // round
+		{
+			++halfMantissa;
+		}
+		return (unsigned short)(sign | halfMantissa);
+	}
+	else if (exponent >= 31)
+	{
+		if (((bits >> 23) & 0xff) == 0xff && mantissa)
+		{
+			return (unsigned short)(sign | 0x7e00); // NaN
+		}
+		return (unsigned short)(sign | 0x7c00); // infinity
+	}
+
+	unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+	if (mantissa & 0x00001000) // round, may carry into exponent which is still correct
+	{
+		++half;
+	}
+	return (unsigned short)half;
+}
+
+//! Compresses 16 values into an 8 byte BC4 block
+static void compressBc4Block(unsigned char* block, const unsigned char* values)
+{
+	unsigned char minValue = 255;
+	unsigned char maxValue = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		minValue = std::min(minValue, values[i]);
+		maxValue = std::max(maxValue, values[i]);
+	}
+
+	block[0] = maxValue;
+	block[1] = minValue;
+	memset(block + 2, 0, 6);
+	if (maxValue == minValue)
+	{
+		return;
+	}
+
+	// With red0 > red1, palette indices 0 and 1 are the end points and 2-7 interpolate from red0 towards red1
+	static const int rampToIndex[8] = {0, 2, 3, 4, 5, 6, 7, 1};
+	unsigned long long indices = 0;
+	int range = maxValue - minValue;
+	for (int i = 0; i < 16; ++i)
+	{
+		int ramp = ((maxValue - values[i]) * 7 + range / 2) / range; // 0 = max, 7 = min
+		indices |= (unsigned long long)rampToIndex[ramp] << (3 * i);
+	}
+
+	for (int i = 0; i < 6; ++i)
+	{
+		block[2 + i] = (unsigned char)(indices >> (8 * i));
+	}
+}
+
+//! Encodes a unit vector into [0, 1]^2 by octahedral projection
+static void octahedralEncode(float& u, float& v, float x, float y, float z)
+{
+	float sum = std::abs(x) + std::abs(y) + std::abs(z);
+	if (sum > 0)
+	{
+		x /= sum;
+		y /= sum;
+		z /= sum;
+	}
+
+	if (z < 0)
+	{
+		float ox = (1 - std::abs(y)) * (x >= 0 ? 1.0f : -1.0f);
+		float oy = (1 - std::abs(x)) * (y >= 0 ? 1.0f : -1.0f);
+		x = ox;
+		y = oy;
+	}
+
+	u = x * 0.5f + 0.5f;
+	v = y * 0.5f + 0.5f;
+}
+
+static unsigned char toUNorm8(float value)
+{
+	return (unsigned char)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+std::vector<unsigned char> compressImage(const ImageBufferUChar& image, VoxelFormat format)
+{
+	assert(format == VoxelFormat_BC4 || format == VoxelFormat_BC5);
+	assert(image.width % 4 == 0 && image.height % 4 == 0);
+	assert(format != VoxelFormat_BC5 || image.channelCount == 3);
+
+	int channelCount = (format == VoxelFormat_BC4) ? 1 : 2;
+	int blockSizeBytes = 8 * channelCount;
+	int blockCountX = image.width / 4;
+	int blockCountY = image.height / 4;
+
+	std::vector<unsigned char> result((size_t)blockCountX * blockCountY * image.depth * blockSizeBytes);
+	unsigned char* block = &result[0];
+
+	for (int z = 0; z < image.depth; ++z)
+	{
+		for (int by = 0; by < blockCountY; ++by)
+		{
+			for (int bx = 0; bx < blockCountX; ++bx)
+			{
+				unsigned char values[2][16];
+				for (int i = 0; i < 16; ++i)
+				{
+					const unsigned char* p = const_cast<ImageBufferUChar&>(image).getElement(bx * 4 + i % 4, by * 4 + i / 4, z);
+					if (format == VoxelFormat_BC4)
+					{
+						values[0][i] = p[0];
+					}
+					else
+					{
+						float u, v;
+						octahedralEncode(u, v, p[0] / 127.5f - 1.0f, p[1] / 127.5f - 1.0f, p[2] / 127.5f - 1.0f);
+						values[0][i] = toUNorm8(u);
+						values[1][i] = toUNorm8(v);
+					}
+				}
+
+				for (int c = 0; c < channelCount; ++c)
+				{
+					compressBc4Block(block, values[c]);
+					block += 8;
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+} // namespace GSparseVolumes
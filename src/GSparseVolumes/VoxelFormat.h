@@ -0,0 +1,60 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "ImageBuffer.h"
+#include <GVis/Texture.h>
+
+#include <vector>
+
+namespace GSparseVolumes {
+
+//! Storage format of voxels in a texture atlas
+enum VoxelFormat
+{
+	VoxelFormat_UNorm8, //!< 1, 3 or 4 channels. Values in [0, 1] quantized to 8 bits.
+	VoxelFormat_UNorm16, //!< 1 channel. Values in [0, 1] quantized to 16 bits.
+	VoxelFormat_Float16, //!< 1 channel. Half float, values are not clamped.
+	VoxelFormat_BC4, //!< 1 channel. 8 bit values block compressed to 4 bits per voxel.
+	VoxelFormat_BC5 //!< 3 channel normals (encoded as n * 0.5 + 0.5) stored octahedral encoded in 2 channels, block compressed to 8 bits per voxel.
+};
+
+//! @return texture pixel format used to store voxels. Throws if format does not support channelCount.
+extern GVis::PixelFormat toPixelFormat(VoxelFormat format, int channelCount);
+
+//! @return true if voxels are staged at 16 bits per channel rather than 8 bits before upload
+extern bool isSixteenBitVoxelFormat(VoxelFormat format);
+
+//! @return true if voxels are compressed in 4x4 blocks. Atlas item widths must then be multiples of 4.
+extern bool isBlockCompressedVoxelFormat(VoxelFormat format);
+
+//! Converts a float to IEEE 754 half float bits. Out of range values become infinity.
+extern unsigned short floatToHalf(float value);
+
+/*! Block compresses a 3d 8 bit image as a stack of 2d slices.
+	For BC4, channel 0 is compressed. For BC5, the image must have 3 channels holding normals encoded as n * 0.5 + 0.5.
+	The normals are octahedral encoded into 2 channels before compression.
+	Width and height must be multiples of 4.
+	@return compressed data in the layout expected by glCompressedTexImage3D for a 2d array texture
+*/
+extern std::vector<unsigned char> compressImage(const ImageBufferUChar& image, VoxelFormat format);
+
+} // namespace GSparseVolumes
@@ -22,44 +22,75 @@
 
 #include <openvdb/math/Operators.h>
 #include <openvdb/tools/Filter.h>
+#include <openvdb/tree/LeafManager.h>
+
+#include <tbb/parallel_for.h>
 
 namespace GSparseVolumes {
 
 // Use a custom gradient function instead of openvdb::tools::Gradient so that we can operate on all values, not use 'On' values.
 // Need to operate on all values because zero density values from which a meaningful normal can be calculated may be represented as 'Off' values near the isosurface.
-class GridNormalCalculator
+template<typename MapT>
+class LeafNormalCalculator
 {
 public:
-	GridNormalCalculator(Vec3UByteGrid& outputGrid, const openvdb::FloatGrid& inputGrid) :
-		m_outputGrid(outputGrid),
+	typedef openvdb::tree::LeafManager<Vec3UByteTree>::LeafRange LeafRange;
+
+	LeafNormalCalculator(const MapT& map, const openvdb::FloatGrid& inputGrid) :
+		m_map(map),
 		m_inputGrid(inputGrid)
 	{
 	}
 
-    template<typename MapT>
-    void operator()(const MapT& map)
+	void operator()(const LeafRange& range) const
 	{
-		// Iterate over grid and calculate normals
-		const openvdb::FloatGrid::ConstAccessor& accessor = m_inputGrid.getConstAccessor();
-		const openvdb::math::Transform& transform = m_inputGrid.transform();
+		// Accessors cache nodes so are not thread safe. Use one per range.
+		openvdb::FloatGrid::ConstAccessor accessor = m_inputGrid.getConstAccessor();
 
-		for (Vec3UByteGrid::ValueAllIter iter = m_outputGrid.beginValueAll(); iter.test(); ++iter) {
-			openvdb::Vec3f value = openvdb::math::Gradient<MapT, openvdb::math::CD_2ND>::result(map, accessor, iter.getCoord());
-			if (value.dot(value) > 0.0001f)
+		for (LeafRange::Iterator leaf = range.begin(); leaf; ++leaf)
+		{
+			for (Vec3UByteTree::LeafNodeType::ValueAllIter iter = leaf->beginValueAll(); iter.test(); ++iter)
 			{
-				float length = value.length();
-				value /= std::max(0.01f, length);
-				value = value * 0.5f + 0.5f;
+				openvdb::Vec3f value = openvdb::math::Gradient<MapT, openvdb::math::CD_2ND>::result(m_map, accessor, iter.getCoord());
+				if (value.dot(value) > 0.0001f)
+				{
+					float length = value.length();
+					value /= std::max(0.01f, length);
+					value = value * 0.5f + 0.5f;
 
-				Vec3UByte byteValue(value.x() * 255, value.y() * 255, value.z() * 255);
-				iter.setValue(byteValue);
+					Vec3UByte byteValue(value.x() * 255, value.y() * 255, value.z() * 255);
+					iter.setValue(byteValue);
+				}
 			}
 		}
 	}
 
 private:
+	const MapT& m_map;
 	const openvdb::FloatGrid& m_inputGrid;
+};
+
+//! Calculates normals for all voxels of the output grid's leaves in parallel.
+//! Tiles are not visited because only leaves are rendered.
+class GridNormalCalculator
+{
+public:
+	GridNormalCalculator(Vec3UByteGrid& outputGrid, const openvdb::FloatGrid& inputGrid) :
+		m_outputGrid(outputGrid),
+		m_inputGrid(inputGrid)
+	{
+	}
+
+	template<typename MapT>
+	void operator()(const MapT& map)
+	{
+		openvdb::tree::LeafManager<Vec3UByteTree> leafManager(m_outputGrid.tree());
+		tbb::parallel_for(leafManager.leafRange(), LeafNormalCalculator<MapT>(map, m_inputGrid));
+	}
+
+private:
 	Vec3UByteGrid& m_outputGrid;
+	const openvdb::FloatGrid& m_inputGrid;
 };
 
 Vec3UByteGrid::Ptr createNormalGrid(const openvdb::FloatGrid& inputGrid)
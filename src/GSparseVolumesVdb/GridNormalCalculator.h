@@ -25,6 +25,7 @@
 
 namespace GSparseVolumes {
 
+//! Creates a grid with the topology of inputGrid containing density gradient normals. Leaves are processed in parallel.
 extern Vec3UByteGrid::Ptr createNormalGrid(const openvdb::FloatGrid& inputGrid);
 
 } // namespace GSparseVolumes
\ No newline at end of file
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "GSparseVolumes/Grid.h"
+#include "GSparseVolumes/GridTopology.h"
 #include "VdbInternalNode.h"
 
 namespace GSparseVolumes {
@@ -44,28 +45,23 @@ public:
 
 	InternalNodePtr next()
 	{
-		for (; m_it; ++m_it)
+		skipToLeafParentNode();
+		if (m_it)
 		{
-			switch (m_it.getDepth())
-			{
-				case leafParentNodeDepth:
-				{
-					const Int2Type* node = 0;
-					m_it.getNode(node);
-					assert(node);
+			const Int2Type* node = 0;
+			m_it.getNode(node);
+			assert(node);
 
-					++m_it;
-					return InternalNodePtr(new VdbInternalNode<Int2Type>(node));
-				}
-			}
+			++m_it;
+			return InternalNodePtr(new VdbInternalNode<Int2Type>(node));
 		}
 		return InternalNodePtr();
 	}
 
 	bool hasNext() const
 	{
-		VdbInternalNodeIterator i = *this;
-		return (i.next() != 0);
+		skipToLeafParentNode();
+		return m_it;
 	}
 
 	InternalNodeIteratorPtr clone() const
@@ -74,7 +70,17 @@ public:
 	}
 
 private:
-	NodeCIter m_it;
+	//! Advances to the next leaf parent node, or the end. Doesn't change the sequence returned by next().
+	void skipToLeafParentNode() const
+	{
+		while (m_it && m_it.getDepth() != leafParentNodeDepth)
+		{
+			++m_it;
+		}
+	}
+
+private:
+	mutable NodeCIter m_it;
 };
 
 /*
@@ -88,15 +94,9 @@ class VdbGrid : public Grid
 public:
 	VdbGrid(const GridTypePtr& grid, int channelCount) :
 		m_grid(grid),
-		m_channelCount(channelCount)
+		m_channelCount(channelCount),
+		m_internalNodeCount(-1)
 	{
-		// count number of internal nodes
-		m_internalNodeCount = 0;
-		InternalNodeIteratorPtr i = createInternalNodeIterator();
-		while (i->next())
-		{
-			m_internalNodeCount++;
-		}
 	}
 
 	size_t getMaxLeafCountPerInternalNode() const
@@ -114,8 +114,20 @@ public:
 		return GridType::TreeType::LeafNodeType::DIM;
 	}
 
+	//! Counted on first call, so that constructing a VdbGrid does not traverse the tree
 	size_t getInternalNodeCount() const
 	{
+		if (m_internalNodeCount < 0)
+		{
+			m_internalNodeCount = 0;
+			for (typename GridType::TreeType::NodeCIter it = m_grid->constTree().cbeginNode(); it; ++it)
+			{
+				if (it.getDepth() == VdbInternalNodeIterator<GridType>::leafParentNodeDepth)
+				{
+					m_internalNodeCount++;
+				}
+			}
+		}
 		return m_internalNodeCount;
 	}
 
@@ -129,10 +141,35 @@ public:
 		return m_channelCount;
 	}
 
+	void buildTopology(GridTopology& topology) const
+	{
+		assert(topology.getInternalNodeCount() == 0);
+		for (typename GridType::TreeType::NodeCIter it = m_grid->constTree().cbeginNode(); it; ++it)
+		{
+			if (it.getDepth() != VdbInternalNodeIterator<GridType>::leafParentNodeDepth)
+			{
+				continue;
+			}
+
+			const Int2Type* node = 0;
+			it.getNode(node);
+			assert(node);
+
+			openvdb::CoordBBox bbox = node->getNodeBoundingBox();
+			topology.internalNodeSize = toVec3(bbox.dim().asVec3d());
+			topology.addInternalNode(toVec3(bbox.getCenter()));
+
+			for (typename Int2Type::ChildOnCIter leafIt = node->cbeginChildOn(); leafIt; ++leafIt)
+			{
+				topology.addLeaf((int)leafIt.offset());
+			}
+		}
+	}
+
 private:
 	GridTypePtr m_grid;
 	int m_channelCount;
-	size_t m_internalNodeCount;
+	mutable int m_internalNodeCount;
 };
 
 } // namespace GSparseVolumes
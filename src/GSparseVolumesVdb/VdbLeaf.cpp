@@ -20,37 +20,151 @@
 
 #include "VdbLeaf.h"
 
+#include <boost/static_assert.hpp>
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace GSparseVolumes {
 
-void leafToPixel(unsigned char* p, int channelCount, const openvdb::Coord& coord, const openvdb::FloatGrid::TreeType::LeafNodeType& leaf)
+typedef openvdb::FloatGrid::TreeType::LeafNodeType FloatLeaf;
+typedef Vec3UByteGrid::TreeType::LeafNodeType Vec3UByteLeaf;
+
+#ifdef __SSE2__
+//! Converts 4 floats to 32 bit ints in [0, 255]. Clamps before converting, since out of range conversions give INT_MIN.
+static inline __m128i quantize4(const float* src, __m128 scale)
+{
+	// maxps returns its second operand if either is NaN, so NaN becomes 0
+	__m128 value = _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src), scale), _mm_setzero_ps());
+	return _mm_cvttps_epi32(_mm_min_ps(value, scale));
+}
+#endif
+
+//! Converts values in [0, 1] to [0, 255]. Values out of range are saturated and NaN becomes 0.
+static void quantize(unsigned char* dest, const float* src, int count)
 {
-	float value;
-	bool active = leaf.probeValue(coord, value);
-	if (!active)
+	// The SIMD and scalar paths must agree, including for NaN and infinity
+	int i = 0;
+#ifdef __SSE2__
+	const __m128 scale = _mm_set1_ps(255.0f);
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i a = quantize4(src + i, scale);
+		__m128i b = quantize4(src + i + 4, scale);
+		__m128i c = quantize4(src + i + 8, scale);
+		__m128i d = quantize4(src + i + 12, scale);
+		__m128i ab = _mm_packs_epi32(a, b);
+		__m128i cd = _mm_packs_epi32(c, d);
+		_mm_storeu_si128((__m128i*)(dest + i), _mm_packus_epi16(ab, cd));
+	}
+#endif
+	for (; i < count; ++i)
 	{
-		value = 0;
+		float value = src[i] * 255.0f;
+		dest[i] = !(value > 0.0f) ? 0 : (value >= 255.0f ? 255 : (unsigned char)value);
 	}
-	else
+}
+
+template <class LeafT, typename T>
+static void clearInactiveVoxels(T* values, const LeafT& leaf)
+{
+	const typename LeafT::NodeMaskType& mask = leaf.getValueMask();
+	if (mask.isOn())
 	{
-		value *= 255.0f;
+		return;
 	}
 
-	for (int i = 0; i < channelCount; ++i)
+	for (int i = 0; i < (int)LeafT::SIZE; ++i)
 	{
-		*p++ = (unsigned char)value;
+		if (mask.isOff(i))
+		{
+			values[i] = 0;
+		}
 	}
 }
 
-void leafToPixel(unsigned char* p, int channelCount, const openvdb::Coord& coord, const Vec3UByteGrid::TreeType::LeafNodeType& leaf)
+/*! Copies voxels stored in openvdb order (index = x*DIM*DIM + y*DIM + z) into buffer in xyz order.
+	Each z slice is a DIM x DIM tile which is transposed into DIM rows of the buffer.
+	Single channel sources are replicated to all buffer channels.
+*/
+template <int DIM, int SRC_CHANNEL_COUNT, typename T>
+static void transposeToImageBuffer(ImageBuffer<T>& buffer, const glm::ivec3& fillOffset, const T* src)
 {
-	Vec3UByte value;
-	leaf.probeValue(coord, value);
+	const int strideX = DIM * DIM * SRC_CHANNEL_COUNT;
+	int destChannelCount = buffer.channelCount;
+	int copyChannelCount = (SRC_CHANNEL_COUNT == 1) ? destChannelCount : std::min(destChannelCount, SRC_CHANNEL_COUNT);
 
-	channelCount = std::min(channelCount, 3);
-	for (int i = 0; i < channelCount; ++i)
+	for (int z = 0; z < DIM; ++z)
 	{
-		*p++ = value[i];
+		for (int y = 0; y < DIM; ++y)
+		{
+			T* p = buffer.getElement(fillOffset.x, fillOffset.y + y, fillOffset.z + z);
+			const T* s = src + (y * DIM + z) * SRC_CHANNEL_COUNT;
+
+			if (destChannelCount == 1)
+			{
+				for (int x = 0; x < DIM; ++x)
+				{
+					p[x] = s[x * strideX];
+				}
+			}
+			else
+			{
+				for (int x = 0; x < DIM; ++x)
+				{
+					const T* v = s + x * strideX;
+					for (int i = 0; i < copyChannelCount; ++i)
+					{
+						p[i] = v[SRC_CHANNEL_COUNT == 1 ? 0 : i];
+					}
+					p += destChannelCount;
+				}
+			}
+		}
 	}
 }
 
-} // namespace GSparseVolumes
\ No newline at end of file
+void leafToImageBuffer(ImageBufferUChar& buffer, const glm::ivec3& fillOffset, const FloatLeaf& leaf)
+{
+	unsigned char values[FloatLeaf::SIZE];
+	quantize(values, &leaf.buffer()[0], FloatLeaf::SIZE);
+	clearInactiveVoxels(values, leaf);
+
+	transposeToImageBuffer<FloatLeaf::DIM, 1>(buffer, fillOffset, values);
+}
+
+void leafToImageBuffer(ImageBufferUChar& buffer, const glm::ivec3& fillOffset, const Vec3UByteLeaf& leaf)
+{
+	BOOST_STATIC_ASSERT(sizeof(Vec3UByte) == 3);
+	const unsigned char* values = reinterpret_cast<const unsigned char*>(&leaf.buffer()[0]);
+
+	transposeToImageBuffer<Vec3UByteLeaf::DIM, 3>(buffer, fillOffset, values);
+}
+
+void leafToImageBuffer(ImageBufferFloat& buffer, const glm::ivec3& fillOffset, const FloatLeaf& leaf)
+{
+	float values[FloatLeaf::SIZE];
+	memcpy(values, &leaf.buffer()[0], sizeof(values));
+	clearInactiveVoxels(values, leaf);
+
+	transposeToImageBuffer<FloatLeaf::DIM, 1>(buffer, fillOffset, values);
+}
+
+void leafToImageBuffer(ImageBufferFloat& buffer, const glm::ivec3& fillOffset, const Vec3UByteLeaf& leaf)
+{
+	const int valueCount = Vec3UByteLeaf::SIZE * 3;
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&leaf.buffer()[0]);
+
+	float values[valueCount];
+	for (int i = 0; i < valueCount; ++i)
+	{
+		values[i] = bytes[i] * (1.0f / 255.0f);
+	}
+
+	transposeToImageBuffer<Vec3UByteLeaf::DIM, 3>(buffer, fillOffset, values);
+}
+
+} // namespace GSparseVolumes
@@ -26,15 +26,22 @@
 
 namespace GSparseVolumes {
 
-extern void leafToPixel(unsigned char* p, int channelCount, const openvdb::Coord& coord, const openvdb::FloatGrid::TreeType::LeafNodeType& leaf);
-extern void leafToPixel(unsigned char* p, int channelCount, const openvdb::Coord& coord, const Vec3UByteGrid::TreeType::LeafNodeType& leaf);
+//! Copies all voxels of leaf into buffer at fillOffset, converting from openvdb zyx order to buffer xyz order.
+//! Float values in [0, 1] are quantized to [0, 255]. Inactive float voxels are written as 0.
+extern void leafToImageBuffer(ImageBufferUChar& buffer, const glm::ivec3& fillOffset, const openvdb::FloatGrid::TreeType::LeafNodeType& leaf);
+extern void leafToImageBuffer(ImageBufferUChar& buffer, const glm::ivec3& fillOffset, const Vec3UByteGrid::TreeType::LeafNodeType& leaf);
 
+//! Full precision versions. Inactive float voxels are written as 0. Vec3UByte values are normalized to [0, 1].
+extern void leafToImageBuffer(ImageBufferFloat& buffer, const glm::ivec3& fillOffset, const openvdb::FloatGrid::TreeType::LeafNodeType& leaf);
+extern void leafToImageBuffer(ImageBufferFloat& buffer, const glm::ivec3& fillOffset, const Vec3UByteGrid::TreeType::LeafNodeType& leaf);
+
+//! References a leaf node owned by a vdb tree. The tree must outlive the VdbLeaf.
 template <typename T>
 class VdbLeaf : public Leaf
 {
 public:
 	VdbLeaf(const T& leaf, size_t offsetInInternalNode) :
-		m_leaf(leaf),
+		m_leaf(&leaf),
 		m_offsetInInternalNode(offsetInInternalNode)
 	{
 
@@ -47,35 +54,34 @@ public:
 
 	virtual int getVoxelCountPerDimension() const
 	{
-		return m_leaf.dim();
+		return m_leaf->dim();
 	}
 
 	virtual void toImageBuffer(ImageBufferUChar& buffer, const glm::ivec3& fillOffset) const
 	{
-		int leafWidth = m_leaf.dim();
+		assertFits(buffer, fillOffset);
+		leafToImageBuffer(buffer, fillOffset, *m_leaf);
+	}
+
+	virtual void toImageBuffer(ImageBufferFloat& buffer, const glm::ivec3& fillOffset) const
+	{
+		assertFits(buffer, fillOffset);
+		leafToImageBuffer(buffer, fillOffset, *m_leaf);
+	}
+
+private:
+	template <typename BufferT>
+	void assertFits(const BufferT& buffer, const glm::ivec3& fillOffset) const
+	{
+		int leafWidth = m_leaf->dim();
 
 		assert(fillOffset.x + leafWidth <= buffer.width);
 		assert(fillOffset.y + leafWidth <= buffer.height);
 		assert(fillOffset.z + leafWidth <= buffer.depth);
-
-		// We access openvdb data by Coord instead of linearly walking through buffer by index
-		// because openvdb leaf buffer is packed in zyx order and we store our texture in xyz order
-		for (int z = 0; z < leafWidth; ++z)
-		{
-			for (int y = 0; y < leafWidth; ++y)
-			{
-				unsigned char* p = buffer.getElement(fillOffset.x, fillOffset.y + y, fillOffset.z + z);
-				for (int x = 0; x < leafWidth; ++x)
-				{
-					leafToPixel(p, buffer.channelCount, openvdb::Coord(x,y,z), m_leaf);
-					p += buffer.channelCount;
-				}
-			}
-		}
 	}
 
 private:
-	T m_leaf;
+	const T* m_leaf;
 	size_t m_offsetInInternalNode;
 };
 
@@ -0,0 +1,85 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "VdbPreprocessing.h"
+
+#include <openvdb/tools/Statistics.h>
+#include <openvdb/tools/ValueTransformer.h>
+
+#include <stdexcept>
+
+namespace GSparseVolumes {
+
+class RescaleValueOp
+{
+public:
+	RescaleValueOp(float minValue, float scale) :
+		m_minValue(minValue),
+		m_scale(scale)
+	{
+	}
+
+	void operator()(const openvdb::FloatGrid::ValueOnIter& iter) const
+	{
+		iter.setValue((*iter - m_minValue) * m_scale);
+	}
+
+private:
+	float m_minValue;
+	float m_scale;
+};
+
+void normalizeActiveValues(openvdb::FloatGrid& grid)
+{
+	openvdb::math::Extrema extrema = openvdb::tools::extrema(grid.cbeginValueOn());
+	float range = float(extrema.max() - extrema.min());
+	if (range <= 0.0f)
+	{
+		return;
+	}
+
+	openvdb::tools::foreach(grid.beginValueOn(), RescaleValueOp(float(extrema.min()), 1.0f / range));
+}
+
+//! Adds a leaf to dest at the origin of each leaf in src. Active tiles covering a new leaf are densified into it.
+static void touchLeaves(openvdb::FloatTree& dest, const openvdb::FloatTree& src)
+{
+	for (openvdb::FloatTree::LeafCIter i = src.cbeginLeaf(); i; ++i)
+	{
+		dest.touchLeaf(i->origin());
+	}
+}
+
+void unionTopology(openvdb::FloatGrid& a, openvdb::FloatGrid& b)
+{
+	a.tree().topologyUnion(b.tree());
+	b.tree().topologyUnion(a.tree());
+
+	// Where one tree has an active tile and the other has a leaf, the union keeps the tile, so the leaf sets can still differ
+	touchLeaves(a.tree(), b.tree());
+	touchLeaves(b.tree(), a.tree());
+
+	if (a.tree().leafCount() != b.tree().leafCount())
+	{
+		throw std::runtime_error("Grid leaf topologies differ after union: " + a.getName() + ", " + b.getName());
+	}
+}
+
+} // namespace GSparseVolumes
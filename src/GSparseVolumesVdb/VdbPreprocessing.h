@@ -0,0 +1,40 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <openvdb/openvdb.h>
+
+namespace GSparseVolumes {
+
+/*! Linearly rescales the active values of grid to between 0 and 1.
+	Finding the range and rescaling are both multithreaded. Grids with a single active value are left unchanged.
+*/
+extern void normalizeActiveValues(openvdb::FloatGrid& grid);
+
+/*! Gives a and b the same active topology, the union of both, with identical leaves.
+	Newly activated voxels keep their existing inactive values. Neither tree's active values are modified.
+	Active tiles which overlap a leaf in the other tree are densified into leaves.
+	Needed so that grids rendered together have the same hierarchy, since leaves are iterated in step across grids.
+	@throws std::runtime_error if the leaf sets still differ
+*/
+extern void unionTopology(openvdb::FloatGrid& a, openvdb::FloatGrid& b);
+
+} // namespace GSparseVolumes
@@ -0,0 +1,85 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "Math.h"
+
+#include <float.h>
+
+namespace GVis {
+
+//! Axis aligned box. A default constructed box is empty.
+struct BoundingBox
+{
+	BoundingBox() :
+		minimum(FLT_MAX, FLT_MAX, FLT_MAX),
+		maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX)
+	{
+	}
+
+	BoundingBox(const glm::vec3& minimum, const glm::vec3& maximum) :
+		minimum(minimum),
+		maximum(maximum)
+	{
+	}
+
+	static BoundingBox fromCenterAndHalfSize(const glm::vec3& center, const glm::vec3& halfSize)
+	{
+		return BoundingBox(center - halfSize, center + halfSize);
+	}
+
+	bool isEmpty() const {return minimum.x > maximum.x;}
+
+	glm::vec3 getCenter() const {return (minimum + maximum) * 0.5f;}
+	glm::vec3 getHalfSize() const {return (maximum - minimum) * 0.5f;}
+
+	//! Grows this box to enclose other
+	void merge(const BoundingBox& other)
+	{
+		minimum = glm::min(minimum, other.minimum);
+		maximum = glm::max(maximum, other.maximum);
+	}
+
+	//! @return the smallest axis aligned box enclosing this box after transformation
+	BoundingBox transformed(const glm::mat4& transform) const
+	{
+		if (isEmpty())
+		{
+			return *this;
+		}
+
+		glm::vec3 center(transform * glm::vec4(getCenter(), 1.0f));
+
+		glm::mat3 absRotationScale(transform);
+		for (int i = 0; i < 3; ++i)
+		{
+			absRotationScale[i] = glm::abs(absRotationScale[i]);
+		}
+		glm::vec3 halfSize = absRotationScale * getHalfSize();
+
+		return fromCenterAndHalfSize(center, halfSize);
+	}
+
+	glm::vec3 minimum;
+	glm::vec3 maximum;
+};
+
+} // namespace GVis
@@ -35,7 +35,7 @@ Camera::~Camera()
 
 const glm::mat4& Camera::getViewMatrix() const
 {
-	m_cachedViewMatrix = glm::inverse(getTransform());
+	m_cachedViewMatrix = getInverseTransform();
 	return m_cachedViewMatrix;
 }
 
@@ -32,6 +32,8 @@ GLenum toGlTargetType(TextureType type)
 		return GL_TEXTURE_2D;
 	case TextureType_3d:
 		return GL_TEXTURE_3D;
+	case TextureType_2dArray:
+		return GL_TEXTURE_2D_ARRAY;
 	case TextureType_Buffer:
 		return GL_TEXTURE_BUFFER;
 	default:
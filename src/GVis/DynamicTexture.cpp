@@ -21,40 +21,148 @@
 #include "DynamicTexture.h"
 #include <GL/glew.h>
 
+#include <assert.h>
 #include <string.h>
 
 namespace GVis {
 
-DynamicTexture::DynamicTexture(const ImageTextureConfig& config) :
-	Texture(config)
+DynamicTexture::DynamicTexture(const ImageTextureConfig& config, int bufferCount) :
+	Texture(config),
+	m_buffers(bufferCount),
+	m_currentBuffer(0),
+	m_persistentlyMapped(GLEW_ARB_buffer_storage != 0),
+	m_writing(false),
+	m_writeMapped(false)
 {
-	glGenBuffersARB(1, &m_bufferId);	
+	assert(bufferCount > 0);
 	m_dataSize = getByteSizeofPixel(config.format) * m_width * m_height * m_depth;
+
+	for (int i = 0; i < bufferCount; i++)
+	{
+		PixelBuffer& buffer = m_buffers[i];
+		buffer.persistentData = 0;
+		buffer.fence = 0;
+
+		glGenBuffers(1, &buffer.bufferId);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.bufferId);
+
+		if (m_persistentlyMapped)
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_PIXEL_UNPACK_BUFFER, m_dataSize, 0, flags);
+			buffer.persistentData = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_dataSize, flags);
+		}
+		else
+		{
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, m_dataSize, 0, GL_STREAM_DRAW);
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 }
 
 DynamicTexture::~DynamicTexture()
 {
-	glDeleteBuffersARB(1, &m_bufferId);
+	for (size_t i = 0; i < m_buffers.size(); i++)
+	{
+		PixelBuffer& buffer = m_buffers[i];
+		if (buffer.fence)
+		{
+			glDeleteSync(buffer.fence);
+		}
+
+		if (buffer.persistentData)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.bufferId);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+		glDeleteBuffers(1, &buffer.bufferId);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 }
 
-void DynamicTexture::setData(void* data)
+void DynamicTexture::setData(const void* data)
 {
-	// Bind PBO to update texture source
-	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, m_bufferId);
+	void* ptr = beginWrite();
+	if (ptr)
+	{
+		memcpy(ptr, data, m_dataSize);
+	}
+	endWrite();
+}
 
-	glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, m_dataSize, 0, GL_STREAM_DRAW_ARB); // discards data in PBO so glMapBufferARB won't stall
+void DynamicTexture::waitForBuffer(int index)
+{
+	PixelBuffer& buffer = m_buffers[index];
+	if (buffer.fence)
+	{
+		// Flush on the first wait so the fence is guaranteed to be signalled eventually
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		const GLuint64 timeoutNs = 1000000000;
+		while (glClientWaitSync(buffer.fence, flags, timeoutNs) == GL_TIMEOUT_EXPIRED)
+		{
+			flags = 0;
+		}
+		glDeleteSync(buffer.fence);
+		buffer.fence = 0;
+	}
+}
+
+void* DynamicTexture::beginWrite()
+{
+	assert(!m_writing);
+	m_writing = true;
+
+	m_currentBuffer = (m_currentBuffer + 1) % (int)m_buffers.size();
+	waitForBuffer(m_currentBuffer);
 
-	// map the buffer object into client's memory
-	GLubyte* ptr = (GLubyte*)glMapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB,
-											GL_WRITE_ONLY_ARB);
-	if(ptr)
+	PixelBuffer& buffer = m_buffers[m_currentBuffer];
+	void* ptr;
+	if (m_persistentlyMapped)
 	{
-		// update data directly on the mapped buffer
-		memcpy(ptr, data, m_dataSize);
-		// release the mapped buffer
-		glUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB);
+		ptr = buffer.persistentData;
+	}
+	else
+	{
+		// The fence wait above means the GPU is done with the buffer, so mapping needn't synchronize
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.bufferId);
+		ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_dataSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 	}
 
+	m_writeMapped = (ptr != 0);
+	return ptr;
+}
+
+void DynamicTexture::endWrite()
+{
+	assert(m_writing);
+	m_writing = false;
+
+	// Nothing was written, so there is nothing to unmap or upload
+	if (!m_writeMapped)
+	{
+		return;
+	}
+	m_writeMapped = false;
+
+	PixelBuffer& buffer = m_buffers[m_currentBuffer];
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.bufferId);
+
+	if (!m_persistentlyMapped)
+	{
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+
+	uploadFromBoundBuffer();
+	buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	// release PBO by 'binding' 0.
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void DynamicTexture::uploadFromBoundBuffer()
+{
 	// Copy pixels from PBO to texture object
 	switch (m_type)
 	{
@@ -76,9 +184,6 @@ void DynamicTexture::setData(void* data)
 		default:
 			assert(0);
 	}
-
-	// release PBO by 'binding' 0.
-	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
 }
 
 } // namespace GVis
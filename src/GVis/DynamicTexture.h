@@ -23,19 +23,55 @@
 #include "Texture.h"
 #include "GVisFwd.h"
 
+#include <vector>
+
 namespace GVis {
 
+/*! Texture whose whole image is replaced frequently, e.g. with simulation output each frame.
+	Images are streamed through a ring of pixel buffers so that writing the next image doesn't wait for the
+	GPU to finish reading the previous one. Buffers are persistently mapped when ARB_buffer_storage is available.
+*/
 class DynamicTexture : public Texture
 {
 public:
-	DynamicTexture(const ImageTextureConfig& config);
+	//! @param bufferCount is the number of pixel buffers in the ring. The CPU can run up to this many uploads ahead of the GPU.
+	DynamicTexture(const ImageTextureConfig& config, int bufferCount = 3);
 	~DynamicTexture();
 
-	void setData(void* data);
+	//! Copies data into the next buffer in the ring and uploads it to the texture
+	void setData(const void* data);
+
+	/*! Returns memory of getDataSize() bytes for the next image, so producers can write into it directly without an extra copy.
+		Must be followed by endWrite() before any other call on the texture.
+		Blocks only if the GPU is still reading the image written bufferCount uploads ago.
+		Returns null if the buffer could not be mapped. Callers must not write through a null result,
+		and the following endWrite() then leaves the texture unchanged.
+	*/
+	void* beginWrite();
+
+	//! Uploads the image written since beginWrite() to the texture, unless beginWrite() returned null
+	void endWrite();
+
+	int getDataSize() const {return m_dataSize;}
 
 private:
-	GLuint m_bufferId;
+	void waitForBuffer(int index);
+	void uploadFromBoundBuffer();
+
+private:
+	struct PixelBuffer
+	{
+		GLuint bufferId;
+		void* persistentData; //!< Null unless persistently mapped
+		GLsync fence; //!< Signalled when the GPU has finished reading the buffer. Null if no upload is pending.
+	};
+
+	std::vector<PixelBuffer> m_buffers;
+	int m_currentBuffer;
 	int m_dataSize;
+	bool m_persistentlyMapped;
+	bool m_writing;
+	bool m_writeMapped; //!< True if the buffer being written was mapped by beginWrite()
 };
 
 } // namespace GVis
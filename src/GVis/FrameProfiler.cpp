@@ -0,0 +1,178 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "FrameProfiler.h"
+#include "GpuTimer.h"
+
+#include <GCommon/CpuTimer.h>
+#include <GCommon/RollingMean.h>
+
+#include <boost/foreach.hpp>
+#include <assert.h>
+#include <iomanip>
+#include <sstream>
+
+using namespace GCommon;
+
+namespace GVis {
+
+struct FrameProfiler::Pass
+{
+	Pass(const std::string& name, int depth, size_t historySize) :
+		name(name),
+		depth(depth),
+		frameCpuSeconds(0),
+		enteredThisFrame(false),
+		meanCpuSeconds(historySize),
+		meanGpuSeconds(historySize),
+		hasGpuSeconds(false)
+	{
+	}
+
+	std::string name;
+	int depth;
+	PassIndexMap childIndices;
+
+	CpuTimer cpuTimer;
+	GpuTimer gpuTimer;
+	double frameCpuSeconds; //!< Sum of CPU time in this pass for the current frame
+	bool enteredThisFrame;
+
+	RollingMean meanCpuSeconds;
+	RollingMean meanGpuSeconds;
+	bool hasGpuSeconds;
+};
+
+FrameProfiler::FrameProfiler(size_t historySize) :
+	m_historySize(historySize)
+{
+}
+
+FrameProfiler::~FrameProfiler()
+{
+}
+
+void FrameProfiler::beginFrame()
+{
+	assert(m_activePasses.empty());
+	beginPass("Frame");
+}
+
+void FrameProfiler::endFrame()
+{
+	endPass();
+	assert(m_activePasses.empty());
+
+	BOOST_FOREACH(const PassPtr& pass, m_passes)
+	{
+		if (pass->enteredThisFrame)
+		{
+			pass->meanCpuSeconds.addValue((float)pass->frameCpuSeconds);
+			pass->frameCpuSeconds = 0;
+			pass->enteredThisFrame = false;
+		}
+
+		m_gpuResults.clear();
+		pass->gpuTimer.endFrame(m_gpuResults);
+		BOOST_FOREACH(double gpuSeconds, m_gpuResults)
+		{
+			pass->meanGpuSeconds.addValue((float)gpuSeconds);
+			pass->hasGpuSeconds = true;
+		}
+	}
+}
+
+void FrameProfiler::beginPass(const std::string& name)
+{
+	PassIndexMap& indices = m_activePasses.empty() ? m_rootPassIndices : m_passes[m_activePasses.back()]->childIndices;
+
+	int index;
+	PassIndexMap::const_iterator i = indices.find(name);
+	if (i == indices.end())
+	{
+		index = (int)m_passes.size();
+		m_passes.push_back(PassPtr(new Pass(name, (int)m_activePasses.size(), m_historySize)));
+		indices[name] = index;
+	}
+	else
+	{
+		index = i->second;
+	}
+
+	m_activePasses.push_back(index);
+
+	Pass& pass = *m_passes[index];
+	pass.enteredThisFrame = true;
+	pass.gpuTimer.begin();
+	pass.cpuTimer.reset();
+}
+
+void FrameProfiler::endPass()
+{
+	assert(!m_activePasses.empty());
+	Pass& pass = *m_passes[m_activePasses.back()];
+	m_activePasses.pop_back();
+
+	pass.frameCpuSeconds += pass.cpuTimer.getElapsedSeconds();
+	pass.gpuTimer.end();
+}
+
+void FrameProfiler::getPassTimings(std::vector<PassTimings>& timings) const
+{
+	timings.resize(m_passes.size());
+	for (int i = 0; i < (int)m_passes.size(); i++)
+	{
+		const Pass& pass = *m_passes[i];
+		PassTimings& t = timings[i];
+		t.name = pass.name;
+		t.depth = pass.depth;
+		t.meanCpuSeconds = pass.meanCpuSeconds.getMean();
+		t.meanGpuSeconds = pass.hasGpuSeconds ? boost::optional<float>(pass.meanGpuSeconds.getMean()) : boost::none;
+	}
+}
+
+std::string FrameProfiler::createReport() const
+{
+	std::vector<PassTimings> timings;
+	getPassTimings(timings);
+
+	static const int nameWidth = 32;
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(3);
+	ss << std::left << std::setw(nameWidth) << "Pass" << std::right << std::setw(10) << "CPU ms" << std::setw(10) << "GPU ms";
+	BOOST_FOREACH(const PassTimings& t, timings)
+	{
+		ss << std::endl;
+		ss << std::left << std::setw(nameWidth) << (std::string(t.depth * 2, ' ') + t.name);
+		ss << std::right << std::setw(10) << t.meanCpuSeconds * 1000.0f;
+		if (t.meanGpuSeconds)
+		{
+			ss << std::setw(10) << *t.meanGpuSeconds * 1000.0f;
+		}
+		else
+		{
+			ss << std::setw(10) << "-";
+		}
+	}
+	return ss.str();
+}
+
+} // namespace GVis
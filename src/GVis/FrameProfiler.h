@@ -0,0 +1,105 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "GVisFwd.h"
+
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace GVis {
+
+//! Rolling mean timings of a profiled pass
+struct PassTimings
+{
+	std::string name;
+	int depth; //!< Number of enclosing passes
+	float meanCpuSeconds;
+	boost::optional<float> meanGpuSeconds; //!< Not set until GPU results are available
+};
+
+/*! Attributes CPU and GPU frame time to named, nestable passes.
+	Passes are identified by their name and enclosing pass, so the same name used in different parents is timed separately.
+	A pass can be entered several times per frame, in which case its times are summed.
+*/
+class FrameProfiler : boost::noncopyable
+{
+public:
+	//! @param historySize is the number of frames the rolling means are computed over
+	explicit FrameProfiler(size_t historySize = 60);
+	~FrameProfiler();
+
+	//! The whole frame is timed as a root pass named "Frame"
+	void beginFrame();
+	void endFrame();
+
+	void beginPass(const std::string& name);
+	void endPass();
+
+	//! Returns timings in the order passes were first entered, which places each pass after its parent
+	void getPassTimings(std::vector<PassTimings>& timings) const;
+
+	//! Returns a human readable table of getPassTimings()
+	std::string createReport() const;
+
+private:
+	struct Pass;
+	typedef boost::shared_ptr<Pass> PassPtr;
+	typedef std::map<std::string, int> PassIndexMap;
+
+private:
+	size_t m_historySize;
+	std::vector<PassPtr> m_passes;
+	PassIndexMap m_rootPassIndices;
+	std::vector<int> m_activePasses; //!< Stack of entered passes
+	std::vector<double> m_gpuResults; //!< Scratch storage reused by endFrame()
+};
+
+//! Times the enclosing scope as a pass. Does nothing if profiler is null.
+class ProfileScope : boost::noncopyable
+{
+public:
+	ProfileScope(FrameProfiler* profiler, const std::string& name) :
+		m_profiler(profiler)
+	{
+		if (m_profiler)
+		{
+			m_profiler->beginPass(name);
+		}
+	}
+
+	~ProfileScope()
+	{
+		if (m_profiler)
+		{
+			m_profiler->endPass();
+		}
+	}
+
+private:
+	FrameProfiler* m_profiler;
+};
+
+} // namespace GVis
@@ -0,0 +1,59 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "Frustum.h"
+
+namespace GVis {
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	// Gribb-Hartmann plane extraction. glm matrices are column major, so row i is m[*][i].
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		m_planes[i * 2] = rows[3] + rows[i];
+		m_planes[i * 2 + 1] = rows[3] - rows[i];
+	}
+}
+
+bool Frustum::isOutside(const BoundingBox& box) const
+{
+	glm::vec3 center = box.getCenter();
+	glm::vec3 halfSize = box.getHalfSize();
+
+	for (int i = 0; i < 6; ++i)
+	{
+		glm::vec3 normal(m_planes[i]);
+		float distance = glm::dot(normal, center) + m_planes[i].w;
+		float radius = glm::dot(glm::abs(normal), halfSize);
+		if (distance + radius < 0.0f)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace GVis
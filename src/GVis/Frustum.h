@@ -0,0 +1,44 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "BoundingBox.h"
+
+namespace GVis {
+
+//! Clip space volume of a view projection, as six world space planes
+class Frustum
+{
+public:
+	//! @param viewProjection transforms world space to OpenGL clip space
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	/*! @return true if box lies entirely outside one of the planes.
+		Conservative, so may return false for boxes near frustum corners which are not actually visible.
+	*/
+	bool isOutside(const BoundingBox& box) const;
+
+private:
+	//! xyz is the inward facing normal, w is the distance. Not normalized.
+	glm::vec4 m_planes[6];
+};
+
+} // namespace GVis
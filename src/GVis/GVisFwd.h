@@ -34,15 +34,21 @@ class Camera;
 class Compositor;
 class DynamicTexture;
 class FloatShaderParameter;
+class FrameProfiler;
+struct FrameUniformBlock;
+class Frustum;
 class Geo;
+class GpuTimer;
 class Light;
 class Mat4ShaderParameter;
 class Material;
 class MaterialFactory;
 class Mesh;
 struct MeshData;
+struct ObjectUniformBlock;
 class OrthographicProjection;
 class PerspectiveProjection;
+class PixelUnpackBuffer;
 class Projection;
 class Renderable;
 class RenderableNode;
@@ -59,6 +65,7 @@ class ShadowProjector;
 class Technique;
 class Texture;
 class TextureBufferObject;
+class UniformBuffer;
 class Vec2ShaderParameter;
 class Vec3ShaderParameter;
 class Viewport;
@@ -76,6 +83,7 @@ typedef shared_ptr<Material> MaterialPtr;
 typedef shared_ptr<Mesh> MeshPtr;
 typedef shared_ptr<OrthographicProjection> OrthographicProjectionPtr;
 typedef shared_ptr<PerspectiveProjection> PerspectiveProjectionPtr;
+typedef shared_ptr<PixelUnpackBuffer> PixelUnpackBufferPtr;
 typedef shared_ptr<Projection> ProjectionPtr;
 typedef shared_ptr<Renderable> RenderablePtr;
 typedef shared_ptr<RenderableNode> RenderableNodePtr;
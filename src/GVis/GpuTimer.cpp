@@ -0,0 +1,138 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "GpuTimer.h"
+
+#include <assert.h>
+
+namespace GVis {
+
+GpuTimer::GpuTimer(int frameCount) :
+	m_frames(frameCount),
+	m_currentFrame(0),
+	m_skippingFrame(false),
+	m_active(false)
+{
+	assert(frameCount > 0);
+}
+
+GpuTimer::~GpuTimer()
+{
+	for (size_t i = 0; i < m_frames.size(); i++)
+	{
+		if (!m_frames[i].queries.empty())
+		{
+			glDeleteQueries((GLsizei)m_frames[i].queries.size(), &m_frames[i].queries[0]);
+		}
+	}
+}
+
+bool GpuTimer::isSupported()
+{
+	return GLEW_ARB_timer_query != 0;
+}
+
+void GpuTimer::begin()
+{
+	assert(!m_active);
+	m_active = true;
+	if (m_skippingFrame || !isSupported())
+	{
+		return;
+	}
+
+	Frame& frame = m_frames[m_currentFrame];
+	if (frame.usedCount == (int)frame.queries.size())
+	{
+		GLuint queries[2];
+		glGenQueries(2, queries);
+		frame.queries.push_back(queries[0]);
+		frame.queries.push_back(queries[1]);
+	}
+
+	glQueryCounter(frame.queries[frame.usedCount], GL_TIMESTAMP);
+	++frame.usedCount;
+}
+
+void GpuTimer::end()
+{
+	assert(m_active);
+	m_active = false;
+	if (m_skippingFrame || !isSupported())
+	{
+		return;
+	}
+
+	Frame& frame = m_frames[m_currentFrame];
+	glQueryCounter(frame.queries[frame.usedCount], GL_TIMESTAMP);
+	++frame.usedCount;
+}
+
+void GpuTimer::endFrame(std::vector<double>& results)
+{
+	assert(!m_active);
+
+	// Read back pending frames oldest first. Frames complete in order, so stop at the first unfinished one.
+	int frameCount = (int)m_frames.size();
+	for (int i = 1; i <= frameCount; i++)
+	{
+		Frame& frame = m_frames[(m_currentFrame + i) % frameCount];
+		if (frame.usedCount == 0)
+		{
+			continue;
+		}
+
+		double seconds;
+		if (!readResults(frame, seconds))
+		{
+			break;
+		}
+		results.push_back(seconds);
+		frame.usedCount = 0;
+	}
+
+	m_currentFrame = (m_currentFrame + 1) % frameCount;
+	m_skippingFrame = (m_frames[m_currentFrame].usedCount != 0);
+}
+
+bool GpuTimer::readResults(Frame& frame, double& seconds) const
+{
+	// Queries complete in order, so if the last one is available they all are
+	GLuint available = 0;
+	glGetQueryObjectuiv(frame.queries[frame.usedCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		return false;
+	}
+
+	GLuint64 totalNanoseconds = 0;
+	for (int i = 0; i < frame.usedCount; i += 2)
+	{
+		GLuint64 beginTime;
+		GLuint64 endTime;
+		glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &beginTime);
+		glGetQueryObjectui64v(frame.queries[i + 1], GL_QUERY_RESULT, &endTime);
+		totalNanoseconds += endTime - beginTime;
+	}
+	seconds = double(totalNanoseconds) * 1e-9;
+	return true;
+}
+
+} // namespace GVis
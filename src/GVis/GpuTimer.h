@@ -0,0 +1,70 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "GVisFwd.h"
+
+#include <boost/noncopyable.hpp>
+#include <vector>
+
+namespace GVis {
+
+/*! Measures GPU time with timestamp queries without stalling the pipeline.
+	Any number of begin()/end() intervals can be recorded per frame and are summed. Each frame's queries are held
+	in a ring of query sets until the GPU has finished them, so results arrive a few frames late but are never waited on.
+	A set is only reused after its results have been read. If the ring is full of pending sets, the frame is not timed.
+	Does nothing if ARB_timer_query is unsupported.
+*/
+class GpuTimer : boost::noncopyable
+{
+public:
+	//! @param frameCount is the number of frames whose queries can be pending at once. Should exceed the frames the driver queues.
+	explicit GpuTimer(int frameCount = 4);
+	~GpuTimer();
+
+	void begin();
+	void end();
+
+	//! Call once per frame after the last end(). Appends the GPU seconds of each earlier frame whose results became available, oldest first.
+	void endFrame(std::vector<double>& results);
+
+	static bool isSupported();
+
+private:
+	struct Frame
+	{
+		Frame() : usedCount(0) {}
+
+		std::vector<GLuint> queries; //!< Begin and end timestamp query pairs
+		int usedCount; //!< Number of queries issued and not yet read
+	};
+
+	//! @return false if the frame's results are not available yet
+	bool readResults(Frame& frame, double& seconds) const;
+
+private:
+	std::vector<Frame> m_frames;
+	int m_currentFrame;
+	bool m_skippingFrame; //!< True if every set was pending at the start of this frame
+	bool m_active;
+};
+
+} // namespace GVis
@@ -91,6 +91,7 @@ TexturePtr DdsLoader::load(const std::string& filename, ColorSpace colorSpace)
 	// Create texture
 	ImageTextureConfig config = ImageTextureConfig::createDefault();
 	config.manualMipmapCount.reset();
+	config.filter = TextureFilter_Trilinear;
 	config.width = width;
 	config.height = height;
 	config.format = format;
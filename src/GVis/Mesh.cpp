@@ -21,15 +21,18 @@
 #include "Mesh.h"
 #include "Convert.h"
 
+#include <algorithm>
 #include <assert.h>
+#include <limits>
 
 namespace GVis {
 
 struct VertexAttribute
 {
-	VertexAttribute(int index, int size) :
+	VertexAttribute(int index, int size, int divisor = 0) :
 		m_index(index),
 		m_attributeSize(size),
+		m_divisor(divisor),
 		m_bufferId(0)
 	{
 	}
@@ -45,14 +48,21 @@ struct VertexAttribute
 		return m_bufferId;
 	}
 
+	void updateBuffer(const GLfloat* data, int sizeBytes, int offset)
+	{
+		assert(m_bufferId != 0);
+		glBindBuffer(GL_ARRAY_BUFFER, m_bufferId);
+		glBufferSubData(GL_ARRAY_BUFFER, offset, sizeBytes, data);
+	}
+
 	void destroyBuffer()
 	{
 		glDeleteBuffers(1, &m_bufferId);
 	}
 
-	void applyState()
+	//! Records the attribute layout into the currently bound vertex array object
+	void recordState()
 	{
-		// 1st attribute buffer : positions
 		glEnableVertexAttribArray(m_index);
 		glBindBuffer(GL_ARRAY_BUFFER, m_bufferId);
 		glVertexAttribPointer(
@@ -63,29 +73,87 @@ struct VertexAttribute
 		   0,                  // stride
 		   (void*)0            // array buffer offset
 		);
-	}
 
-	void unapplyState()
-	{
-		glDisableVertexAttribArray(m_index);
+		if (m_divisor)
+		{
+			glVertexAttribDivisor(m_index, m_divisor);
+		}
 	}
 
 private:
 	int m_index;
 	int m_attributeSize;
+	int m_divisor;
 	GLuint m_bufferId;
 };
 
 
-static GLuint createElementBuffer(const GLint* data, int size, BufferUsage usage)
+//! @return smallest index type able to address every index in data
+static GLenum chooseIndexType(const GLint* data, int count)
 {
-	assert(data);
+	GLint maxIndex = 0;
+	for (int i = 0; i < count; i++)
+	{
+		assert(data[i] >= 0);
+		maxIndex = std::max(maxIndex, data[i]);
+	}
 
-	GLuint buffer;
-	glGenBuffers(1, &buffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, toGlBufferUsage(usage));
-	return buffer;
+	if (maxIndex <= std::numeric_limits<GLubyte>::max())
+	{
+		return GL_UNSIGNED_BYTE;
+	}
+	else if (maxIndex <= std::numeric_limits<GLushort>::max())
+	{
+		return GL_UNSIGNED_SHORT;
+	}
+	return GL_UNSIGNED_INT;
+}
+
+static int getIndexSizeBytes(GLenum indexType)
+{
+	switch (indexType)
+	{
+	case GL_UNSIGNED_BYTE:
+		return sizeof(GLubyte);
+	case GL_UNSIGNED_SHORT:
+		return sizeof(GLushort);
+	case GL_UNSIGNED_INT:
+		return sizeof(GLuint);
+	default:
+		assert(!"Invalid index type");
+	}
+	return 0;
+}
+
+template <typename T>
+static void narrowIndices(std::vector<unsigned char>& result, const GLint* data, int count)
+{
+	result.resize(count * sizeof(T));
+	T* dest = reinterpret_cast<T*>(&result[0]);
+	for (int i = 0; i < count; i++)
+	{
+		assert(data[i] >= 0 && data[i] <= std::numeric_limits<T>::max());
+		dest[i] = T(data[i]);
+	}
+}
+
+//! Converts indices to indexType. Returns data unchanged if it is already the right type.
+static const void* convertIndices(std::vector<unsigned char>& storage, const GLint* data, int count, GLenum indexType)
+{
+	switch (indexType)
+	{
+	case GL_UNSIGNED_BYTE:
+		narrowIndices<GLubyte>(storage, data, count);
+		return &storage[0];
+	case GL_UNSIGNED_SHORT:
+		narrowIndices<GLushort>(storage, data, count);
+		return &storage[0];
+	case GL_UNSIGNED_INT:
+		return data;
+	default:
+		assert(!"Invalid index type");
+	}
+	return 0;
 }
 
 // --------------------------------------------------------------------
@@ -114,6 +182,7 @@ Mesh::Mesh(PrimitiveType type, int patchVertCount) :
 	m_vertexArray(0),
 	m_indexBuffer(0),
 	m_indexCount(0),
+	m_indexType(GL_UNSIGNED_INT),
 	m_glPrimitiveType(toGlPrimitiveType(type)),
 	m_patchVertCount(patchVertCount),
 	m_instanceCount(1)
@@ -126,6 +195,12 @@ Mesh::~Mesh()
 {
 	glDeleteVertexArrays(1, &m_vertexArray);
 
+	int vertexAttributeCount = m_vertexAttributes.size();
+	for (int i = 0; i < vertexAttributeCount; i++)
+	{
+		m_vertexAttributes[i].destroyBuffer();
+	}
+
 	if (m_indexBuffer)
 	{
 		glDeleteBuffers(1, &m_indexBuffer);
@@ -134,14 +209,8 @@ Mesh::~Mesh()
 
 void Mesh::render()
 {
-	int vertexAttributeCount = m_vertexAttributes.size();
-	for (int i = 0; i < vertexAttributeCount; i++)
-	{
-		m_vertexAttributes[i].applyState();
-	}
-
-	// Index buffer
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	// Attribute and index buffer bindings were recorded into the vertex array when they were set
+	glBindVertexArray(m_vertexArray);
 
 	if (m_glPrimitiveType == GL_PATCHES)
 	{
@@ -150,41 +219,56 @@ void Mesh::render()
 
 	if (m_instanceCount > 1)
 	{
-		glDrawElementsInstanced(m_glPrimitiveType, m_indexCount, GL_UNSIGNED_INT,
+		glDrawElementsInstanced(m_glPrimitiveType, m_indexCount, m_indexType,
 			(void*)0, 			// element array buffer offset
 			m_instanceCount
 		);
 	}
 	else
 	{
-		glDrawElements(m_glPrimitiveType, m_indexCount, GL_UNSIGNED_INT,
+		glDrawElements(m_glPrimitiveType, m_indexCount, m_indexType,
 			(void*)0			// element array buffer offset
 		);
 	}
-
-	for (int i = 0; i < vertexAttributeCount; i++)
-	{
-		m_vertexAttributes[i].unapplyState();
-	}
 }
 
 GLuint Mesh::setIndexBuffer(const GLint& data, int sizeBytes, BufferUsage usage)
 {
+	// Element array binding is vertex array state, so our vertex array must be bound before binding the buffer
+	glBindVertexArray(m_vertexArray);
+
 	if (m_indexBuffer)
 	{
 		glDeleteBuffers(1, &m_indexBuffer);
 	}
 
 	m_indexCount = sizeBytes / sizeof(GLint);
-	m_indexBuffer = createElementBuffer(&data, sizeBytes, usage);
+
+	// Dynamic buffers keep 32 bit indices so that updates can reference any vertex
+	m_indexType = (usage == BufferUsage_Static) ? chooseIndexType(&data, m_indexCount) : GL_UNSIGNED_INT;
+
+	std::vector<unsigned char> convertedIndices;
+	const void* indices = convertIndices(convertedIndices, &data, m_indexCount, m_indexType);
+
+	glGenBuffers(1, &m_indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexCount * getIndexSizeBytes(m_indexType), indices, toGlBufferUsage(usage));
 	return m_indexBuffer;
 }
 
 void Mesh::updateIndexBuffer(const GLint& data, int sizeBytes, int offset)
 {
 	assert(m_indexBuffer != 0);
+
+	int count = sizeBytes / sizeof(GLint);
+	int indexSizeBytes = getIndexSizeBytes(m_indexType);
+
+	std::vector<unsigned char> convertedIndices;
+	const void* indices = convertIndices(convertedIndices, &data, count, m_indexType);
+
+	glBindVertexArray(m_vertexArray);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
-	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, sizeBytes, &data);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset / sizeof(GLint) * indexSizeBytes, count * indexSizeBytes, indices);
 }
 
 GLuint Mesh::addVertexAttribute(const GLfloat& data, int sizeBytes, int elementsPerVertex, BufferUsage usage)
@@ -192,9 +276,34 @@ GLuint Mesh::addVertexAttribute(const GLfloat& data, int sizeBytes, int elements
 	int attributeIndex = m_vertexAttributes.size();
 	m_vertexAttributes.push_back(VertexAttribute(attributeIndex, elementsPerVertex));
 	GLuint buffer = m_vertexAttributes.back().createBuffer(&data, sizeBytes, usage);
+
+	glBindVertexArray(m_vertexArray);
+	m_vertexAttributes.back().recordState();
+	return buffer;
+}
+
+GLuint Mesh::addInstanceAttribute(const GLfloat& data, int sizeBytes, int elementsPerInstance, BufferUsage usage)
+{
+	int attributeIndex = m_vertexAttributes.size();
+	m_vertexAttributes.push_back(VertexAttribute(attributeIndex, elementsPerInstance, 1));
+	GLuint buffer = m_vertexAttributes.back().createBuffer(&data, sizeBytes, usage);
+
+	glBindVertexArray(m_vertexArray);
+	m_vertexAttributes.back().recordState();
 	return buffer;
 }
 
+void Mesh::updateVertexAttribute(int attributeIndex, const GLfloat& data, int sizeBytes, int offset)
+{
+	assert(attributeIndex < m_vertexAttributes.size());
+	m_vertexAttributes[attributeIndex].updateBuffer(&data, sizeBytes, offset);
+}
+
+int Mesh::getVertexAttributeCount() const
+{
+	return (int)m_vertexAttributes.size();
+}
+
 void Mesh::setInstanceCount(int count)
 {
 	assert(count > 0);
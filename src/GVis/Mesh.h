@@ -45,17 +45,32 @@ public:
 	void render();
 
 	//! Creates index buffer and copies in data. Replaces any existing index buffer. Returns OpenGL buffer name.
+	//! Static buffers are stored with the smallest index type that can address every index in data,
+	//! dynamic buffers always use 32 bit indices.
 	GLuint setIndexBuffer(const GLint& data, int sizeBytes, BufferUsage usage = BufferUsage_Static);
 
 	//! updates existing index buffer with new data. Buffer must have previously been created with setIndexBuffer.
-	//! @param sizeBytes specifies the size of the region to be replaced
-	//! @param offset specifies the offset at which to begin data replacment
+	//! Indices must fit the index type chosen by setIndexBuffer.
+	//! @param sizeBytes specifies the size of the region to be replaced, in bytes of GLint data
+	//! @param offset specifies the offset at which to begin data replacment, in bytes of GLint data
 	void updateIndexBuffer(const GLint& data, int sizeBytes, int offset = 0);
 
 	//! Adds by copy
 	//! Returns OpenGL buffer name
 	GLuint addVertexAttribute(const GLfloat& data, int sizeBytes, int elementsPerVertex, BufferUsage usage = BufferUsage_Static);
 
+	//! Adds by copy an attribute which advances once per instance instead of once per vertex
+	//! Returns OpenGL buffer name
+	GLuint addInstanceAttribute(const GLfloat& data, int sizeBytes, int elementsPerInstance, BufferUsage usage = BufferUsage_Dynamic);
+
+	//! updates existing vertex or instance attribute buffer with new data
+	//! @param attributeIndex is the number of attributes added before this one
+	//! @param sizeBytes specifies the size of the region to be replaced
+	//! @param offset specifies the offset at which to begin data replacment
+	void updateVertexAttribute(int attributeIndex, const GLfloat& data, int sizeBytes, int offset = 0);
+
+	int getVertexAttributeCount() const;
+
 	void setInstanceCount(int count);
 
 private:
@@ -63,6 +78,7 @@ private:
 	std::vector<struct VertexAttribute> m_vertexAttributes;
 	GLuint m_indexBuffer;
 	int m_indexCount;
+	GLenum m_indexType;
 	GLenum m_glPrimitiveType;
 	int m_patchVertCount;
 	int m_instanceCount;
@@ -0,0 +1,65 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "PixelUnpackBuffer.h"
+
+#include <GL/glew.h>
+
+#include <assert.h>
+
+namespace GVis {
+
+PixelUnpackBuffer::PixelUnpackBuffer() :
+	m_mapped(false)
+{
+	glGenBuffers(1, &m_buffer);
+}
+
+PixelUnpackBuffer::~PixelUnpackBuffer()
+{
+	glDeleteBuffers(1, &m_buffer);
+}
+
+void* PixelUnpackBuffer::map(size_t sizeBytes)
+{
+	assert(!m_mapped);
+	assert(sizeBytes > 0);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, sizeBytes, 0, GL_STREAM_DRAW);
+	void* data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, sizeBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	m_mapped = (data != 0);
+	return data;
+}
+
+void PixelUnpackBuffer::unmap()
+{
+	if (m_mapped)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		m_mapped = false;
+	}
+}
+
+} // namespace GVis
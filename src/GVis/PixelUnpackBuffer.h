@@ -0,0 +1,52 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "GVisFwd.h"
+
+#include <boost/noncopyable.hpp>
+
+namespace GVis {
+
+/*! Staging buffer for batching texture uploads.
+	Write the images of a batch with map() and unmap(), then copy them into textures with Texture::setSubImage()
+	at offsets into this buffer. The copies run on the GPU, so the CPU does not wait for the texture to be free.
+*/
+class PixelUnpackBuffer : boost::noncopyable
+{
+public:
+	PixelUnpackBuffer();
+	~PixelUnpackBuffer();
+
+	/*! Orphans the storage and maps sizeBytes of it for writing, so the previous batch's copies are never waited on.
+		Returns null if the buffer could not be mapped. Must be followed by unmap() before the buffer is used.
+	*/
+	void* map(size_t sizeBytes);
+	void unmap();
+
+	GLuint _getGlBufferId() const {return m_buffer;}
+
+private:
+	GLuint m_buffer;
+	bool m_mapped;
+};
+
+} // namespace GVis
@@ -27,10 +27,20 @@ namespace GVis {
 
 struct RenderContext
 {
+	RenderContext() :
+		frameUniforms(0),
+		objectUniforms(0)
+	{
+	}
+
 	SceneNodePtr sceneNode;
 	CameraPtr camera;
 	LightPtr light; //!< optional
 	glm::vec2 viewportResolution;
+
+	//! Precomputed uniform block values. Optional, computed from the members above if null.
+	const FrameUniformBlock* frameUniforms;
+	const ObjectUniformBlock* objectUniforms;
 };
 
 }
\ No newline at end of file
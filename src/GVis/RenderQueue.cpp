@@ -19,25 +19,53 @@
 // THE SOFTWARE.
 
 #include "RenderQueue.h"
+#include "Camera.h"
+#include "Frustum.h"
+#include "Material.h"
+#include "Renderable.h"
+#include "RenderableNode.h"
+#include "ShaderProgram.h"
+#include "Technique.h"
+
 #include <GCommon/VectorHelper.h>
 
+#include <boost/foreach.hpp>
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+
 using namespace GCommon;
 
 namespace GVis {
 
 RenderQueue::RenderQueue(RenderSortingMode sortingMode) :
-	m_sortingMode(sortingMode)
+	m_sortingMode(sortingMode),
+	m_name("RenderQueue"),
+	m_itemsDirty(false)
+{
+}
+
+RenderQueue::~RenderQueue()
 {
+	BOOST_FOREACH(const RenderableNodePtr& renderableNode, m_renderableNodes)
+	{
+		renderableNode->m_renderQueue = 0;
+	}
 }
 
 void RenderQueue::addRenderableNode(const RenderableNodePtr& renderableNode)
 {
+	assert(!renderableNode->m_renderQueue);
 	m_renderableNodes.push_back(renderableNode);
+	renderableNode->m_renderQueue = this;
+	m_itemsDirty = true;
 }
 
 void RenderQueue::removeRenderableNode(const RenderableNodePtr& renderableNode)
 {
 	vectorErase<RenderableNodePtr>(m_renderableNodes, renderableNode);
+	renderableNode->m_renderQueue = 0;
+	m_itemsDirty = true;
 }
 
 void RenderQueue::setSortingMode(RenderSortingMode mode)
@@ -45,6 +73,124 @@ void RenderQueue::setSortingMode(RenderSortingMode mode)
 	m_sortingMode = mode;
 }
 
+void RenderQueue::rebuildItems()
+{
+	m_items.clear();
+	int nodeCount = (int)m_renderableNodes.size();
+	for (int i = 0; i < nodeCount; i++)
+	{
+		BOOST_FOREACH(const RenderablePtr& renderable, m_renderableNodes[i]->m_renderables)
+		{
+			Item item;
+			item.renderableNodeIndex = i;
+			item.renderable = renderable.get();
+			m_items.push_back(item);
+		}
+	}
+	m_itemsDirty = false;
+}
+
+//! Returns true if the node can't contribute to the image
+static bool isCulled(const RenderableNode& renderableNode, const Frustum* frustum)
+{
+	if (!renderableNode.isVisible())
+	{
+		return true;
+	}
+
+	const BoundingBox& bounds = renderableNode.getWorldBounds();
+	return frustum && !bounds.isEmpty() && frustum->isOutside(bounds);
+}
+
+//! Non-negative floats order the same as their bit patterns
+static boost::uint32_t toOrderedBits(float nonNegativeValue)
+{
+	boost::uint32_t bits;
+	std::memcpy(&bits, &nonNegativeValue, sizeof(bits));
+	return bits;
+}
+
+static bool drawItemKeyPredicate(const RenderQueueDrawItem& a, const RenderQueueDrawItem& b)
+{
+	return a.key < b.key;
+}
+
+const RenderQueue::DrawItems& RenderQueue::_prepareDrawItems(const Camera& camera, TechniqueCategory category, const Frustum* frustum)
+{
+	if (m_itemsDirty)
+	{
+		rebuildItems();
+	}
+
+	m_drawItems.clear();
+
+	int lastNodeIndex = -1;
+	bool lastNodeCulled = false;
+	boost::uint32_t depthBits = 0;
+
+	int count = (int)m_items.size();
+	for (int i = 0; i < count; i++)
+	{
+		const Item& item = m_items[i];
+
+		// Items of the same node are adjacent, so culling and depth are evaluated once per node
+		if (item.renderableNodeIndex != lastNodeIndex)
+		{
+			lastNodeIndex = item.renderableNodeIndex;
+			const RenderableNode& node = *m_renderableNodes[lastNodeIndex];
+			lastNodeCulled = isCulled(node, frustum);
+			glm::vec3 diff = camera.getPosition() - node.getPosition();
+			depthBits = toOrderedBits(glm::dot(diff, diff));
+		}
+
+		if (lastNodeCulled || !item.renderable->m_material)
+		{
+			continue;
+		}
+
+		Technique* technique = item.renderable->m_material->getTechnique(category).get();
+		if (!technique)
+		{
+			continue;
+		}
+
+		RenderQueueDrawItem drawItem;
+		drawItem.renderableNodeIndex = item.renderableNodeIndex;
+		drawItem.renderable = item.renderable;
+		drawItem.technique = technique;
+
+		switch (m_sortingMode)
+		{
+		case RenderSortingMode_BackToFront:
+			// Inverted depth in the high bits, ties broken by insertion order
+			drawItem.key = (boost::uint64_t(~depthBits) << 32) | boost::uint64_t(i);
+			break;
+		case RenderSortingMode_None:
+			drawItem.key = boost::uint64_t(i);
+			break;
+		case RenderSortingMode_State:
+		{
+			// | program (16 bits) | technique (24 bits) | front to back depth (24 bits) |
+			boost::uint64_t programId = technique->_getShader()->_getProgramId() & 0xffff;
+			boost::uint64_t techniqueId = technique->_getSortId() & 0xffffff;
+			drawItem.key = (programId << 48) | (techniqueId << 24) | boost::uint64_t(depthBits >> 8);
+			break;
+		}
+		default:
+			assert(!"Invalid sorting mode");
+		}
+
+		m_drawItems.push_back(drawItem);
+	}
+
+	if (m_sortingMode != RenderSortingMode_None)
+	{
+		std::sort(m_drawItems.begin(), m_drawItems.end(), drawItemKeyPredicate);
+	}
+
+	return m_drawItems;
+}
+
 int getDefaultRenderQueueId()
 {
 	return 2;
@@ -21,21 +21,35 @@
 #pragma once
 
 #include "GVisFwd.h"
+#include "TechniqueCategory.h"
 
+#include <boost/cstdint.hpp>
+#include <string>
 #include <vector>
 
 namespace GVis {
 
 enum RenderSortingMode
 {
-	RenderSortingMode_BackToFront,
-	RenderSortingMode_None
+	RenderSortingMode_BackToFront, //!< Farthest nodes first. Use for blended geometry.
+	RenderSortingMode_None, //!< Insertion order
+	RenderSortingMode_State //!< Grouped by shader program and technique, then front to back. Use for opaque geometry.
+};
+
+//! A single renderable to draw, with the technique it will be drawn with and its sort key
+struct RenderQueueDrawItem
+{
+	boost::uint64_t key;
+	int renderableNodeIndex; //!< Index into RenderQueue::getRenderableNodes()
+	Renderable* renderable;
+	Technique* technique;
 };
 
 class RenderQueue
 {
 public:
 	RenderQueue(RenderSortingMode sortingMode = RenderSortingMode_None);
+	~RenderQueue();
 
 	typedef std::vector<RenderableNodePtr> RenderableNodes;
 
@@ -47,9 +61,40 @@ public:
 	void setSortingMode(RenderSortingMode mode);
 	RenderSortingMode getSortingMode() const {return m_sortingMode;}
 
+	//! Name the queue is reported under when profiling
+	void setName(const std::string& name) {m_name = name;}
+	const std::string& getName() const {return m_name;}
+
+	typedef std::vector<RenderQueueDrawItem> DrawItems;
+
+	/*! Returns the visible renderables in the order they should be drawn for the camera.
+		The (node, renderable) list is only rebuilt when nodes or renderables are added or removed,
+		and the returned vector is reused between calls so no allocation happens in the steady state.
+		@param frustum can be null to disable culling
+	*/
+	const DrawItems& _prepareDrawItems(const Camera& camera, TechniqueCategory category, const Frustum* frustum);
+
+	//! Called when the renderables of a node in this queue change
+	void _markItemsDirty() {m_itemsDirty = true;}
+
+private:
+	void rebuildItems();
+
 private:
 	RenderableNodes m_renderableNodes;
 	RenderSortingMode m_sortingMode;
+	std::string m_name;
+
+	struct Item
+	{
+		int renderableNodeIndex;
+		Renderable* renderable;
+	};
+
+	std::vector<Item> m_items;
+	bool m_itemsDirty;
+
+	DrawItems m_drawItems;
 };
 
 extern int getDefaultRenderQueueId();
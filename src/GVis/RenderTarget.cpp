@@ -19,6 +19,7 @@
 // THE SOFTWARE.
 
 #include "RenderTarget.h"
+#include "FrameProfiler.h"
 #include "Viewport.h"
 #include "VisSystem.h"
 
@@ -32,7 +33,8 @@ using namespace GCommon;
 
 namespace GVis {
 
-RenderTarget::RenderTarget() :
+RenderTarget::RenderTarget(const std::string& name) :
+	m_name(name),
 	m_framebuffer(0)
 {
 }
@@ -83,6 +85,7 @@ void RenderTarget::_render(const VisSystem& visSystem)
 	}
 
 	// Render self
+	ProfileScope profileScope(visSystem.getProfiler(), m_name);
 	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
 
 	BOOST_FOREACH(const ViewportPtr& viewport, m_viewports)
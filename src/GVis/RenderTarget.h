@@ -24,6 +24,7 @@
 #include "Math.h"
 #include "TechniqueCategory.h"
 
+#include <string>
 #include <vector>
 
 namespace GVis {
@@ -33,7 +34,7 @@ class RenderTarget
 public:
 	typedef std::vector<ViewportPtr> Viewports;
 
-	RenderTarget();
+	explicit RenderTarget(const std::string& name = "RenderTarget");
 
 	ViewportPtr addDefaultViewport(const CameraPtr& camera);
 	void addViewport(const ViewportPtr& viewport);
@@ -51,7 +52,12 @@ public:
 
 	virtual TechniqueCategory getTechniqueCategory() const = 0;
 
+	//! Name the target is reported under when profiling
+	void setName(const std::string& name) {m_name = name;}
+	const std::string& getName() const {return m_name;}
+
 protected:
+	std::string m_name;
 	GLuint m_framebuffer;
 
 	Viewports m_viewports;
@@ -27,6 +27,7 @@
 namespace GVis {
 
 RenderTextureTarget::RenderTextureTarget(const RenderTextureTargetConfig& config) :
+	RenderTarget("RenderTextureTarget"),
 	m_texture(config.texture),
 	m_techniqueCategory(config.techniqueCategory),
 	m_depthBuffer(0),
@@ -29,6 +29,7 @@ namespace GVis {
 class Renderable
 {
 	friend class VisSystem;
+	friend class RenderQueue;
 
 public:
 	Renderable();
@@ -21,6 +21,7 @@
 #include "RenderableNode.h"
 #include "Renderable.h"
 #include "Geo.h"
+#include "RenderQueue.h"
 
 #include <GCommon/VectorHelper.h>
 
@@ -32,6 +33,7 @@ namespace GVis {
 
 RenderableNode::RenderableNode() :
 	m_renderQueueId(0),
+	m_renderQueue(0),
 	m_visible(true),
 	m_wireframeModeEnabled(false)
 {
@@ -40,11 +42,19 @@ RenderableNode::RenderableNode() :
 void RenderableNode::addRenderable(const RenderablePtr& renderable)
 {
 	m_renderables.push_back(renderable);
+	if (m_renderQueue)
+	{
+		m_renderQueue->_markItemsDirty();
+	}
 }
 
 void RenderableNode::removeRenderable(const RenderablePtr& renderable)
 {
 	vectorErase(m_renderables, renderable);
+	if (m_renderQueue)
+	{
+		m_renderQueue->_markItemsDirty();
+	}
 }
 
 void RenderableNode::render(const RenderContext& context, TechniqueCategory techniqueCategory)
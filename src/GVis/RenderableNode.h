@@ -31,6 +31,7 @@ namespace GVis {
 class RenderableNode : public SceneNode
 {
 	friend class VisSystem;
+	friend class RenderQueue;
 
 public:
 	RenderableNode();
@@ -50,6 +51,7 @@ public:
 private:
 	std::vector<RenderablePtr> m_renderables;
 	RenderQueueId m_renderQueueId;
+	RenderQueue* m_renderQueue; //!< Queue this node is in, or null
 
 	bool m_visible;
 	bool m_wireframeModeEnabled;
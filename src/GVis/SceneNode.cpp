@@ -30,29 +30,29 @@ namespace GVis {
 SceneNode::SceneNode(const glm::vec3& position, const glm::quat& orientation) :
 	m_position(position),
 	m_orientation(orientation),
+	m_transformDirty(true),
 	m_parent(0)
 {
-	updateTransform();
 }
 
 void SceneNode::setPosition(const glm::vec3& position)
 {
 	if (m_parent)
 	{
-		m_position = glm::vec3(glm::inverse(m_parent->getTransform()) * glm::vec4(position, 1.0f));
+		m_position = glm::vec3(m_parent->getInverseTransform() * glm::vec4(position, 1.0f));
 	}
 	else
 	{
 		m_position = position;
 	}
 
-	updateTransform();
+	invalidateTransform();
 }
 
 void SceneNode::setPosition_parentSpace(const glm::vec3& position)
 {
 	m_position = position;
-	updateTransform();
+	invalidateTransform();
 }
 
 void SceneNode::setOrientation(const glm::quat& orientation)
@@ -65,13 +65,13 @@ void SceneNode::setOrientation(const glm::quat& orientation)
 	{
 		m_orientation = orientation;
 	}
-	updateTransform();
+	invalidateTransform();
 }
 
 void SceneNode::setOrientation_parentSpace(const glm::quat& orientation)
 {
 	m_orientation = orientation;
-	updateTransform();
+	invalidateTransform();
 }
 
 void SceneNode::setDirection(const glm::vec3& direction, const glm::vec3& upVec)
@@ -95,12 +95,14 @@ void SceneNode::setDirection(const glm::vec3& direction, const glm::vec3& upVec)
 //! @return position in world space
 glm::vec3 SceneNode::getPosition() const
 {
+	resolveTransform();
 	return glm::vec3(m_cachedTransform[3][0], m_cachedTransform[3][1], m_cachedTransform[3][2]);
 }
 
 //! @return orientation in world space
 glm::quat SceneNode::getOrientation() const
 {
+	resolveTransform();
 	return glm::quat_cast(m_cachedTransform);
 }
 
@@ -117,35 +119,52 @@ void SceneNode::translate(const glm::vec3& translation)
 void SceneNode::translateLocal(const glm::vec3& translation)
 {
 	m_position += m_orientation * translation;
-	updateTransform();
+	invalidateTransform();
 }
 
-void SceneNode::updateTransform()
+void SceneNode::invalidateTransform()
 {
-	m_cachedTransform = glm::mat4(); // identity
-	if (m_parent)
+	if (m_transformDirty)
 	{
-		glm::vec3 position = m_parent->getPosition() + m_parent->getOrientation() * m_position;
-		m_cachedTransform = glm::translate(m_cachedTransform, position);
-		m_cachedTransform = m_cachedTransform * glm::mat4_cast(m_parent->getOrientation() * m_orientation);
-	}
-	else
-	{
-		m_cachedTransform = glm::translate(m_cachedTransform, m_position);
-		m_cachedTransform = m_cachedTransform * glm::mat4_cast(m_orientation);
+		return; // descendants are already dirty
 	}
 
+	m_transformDirty = true;
+
 	size_t count = m_children.size();
 	for (size_t i = 0; i < count; ++i)
 	{
-		m_children[i]->updateTransform();
+		m_children[i]->invalidateTransform();
+	}
+}
+
+void SceneNode::updateTransform() const
+{
+	m_cachedTransform = glm::translate(glm::mat4(), m_position) * glm::mat4_cast(m_orientation);
+	if (m_parent)
+	{
+		// Resolves the parent first if it is also dirty
+		m_cachedTransform = m_parent->getTransform() * m_cachedTransform;
+	}
+
+	m_cachedInverseTransform = glm::inverse(m_cachedTransform);
+	m_worldBounds = m_localBounds.transformed(m_cachedTransform);
+	m_transformDirty = false;
+}
+
+void SceneNode::setLocalBounds(const BoundingBox& bounds)
+{
+	m_localBounds = bounds;
+	if (!m_transformDirty)
+	{
+		m_worldBounds = m_localBounds.transformed(m_cachedTransform);
 	}
 }
 
 void SceneNode::setParent(const SceneNode* parent)
 {
 	m_parent = parent;
-	updateTransform();
+	invalidateTransform();
 }
 
 void SceneNode::addChild(const SceneNodePtr& child)
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "GVisFwd.h"
+#include "BoundingBox.h"
 #include "Math.h"
 
 #include <vector>
@@ -59,7 +60,10 @@ public:
 	glm::vec3 getDirection() const;
 
 	//! @return transform in world space
-	const glm::mat4& getTransform() const {return m_cachedTransform;}
+	const glm::mat4& getTransform() const {resolveTransform(); return m_cachedTransform;}
+
+	//! @return inverse of getTransform()
+	const glm::mat4& getInverseTransform() const {resolveTransform(); return m_cachedInverseTransform;}
 
 	//! @param translation in world space
 	void translate(const glm::vec3& translation);
@@ -67,17 +71,43 @@ public:
 	//! @return translation in local space
 	void translateLocal(const glm::vec3& translation);
 
+	//! @param bounds of the node's contents in local space. Nodes with empty bounds (the default) are never culled.
+	void setLocalBounds(const BoundingBox& bounds);
+	const BoundingBox& getLocalBounds() const {return m_localBounds;}
+
+	//! @return local bounds enclosed in a world space box
+	const BoundingBox& getWorldBounds() const {resolveTransform(); return m_worldBounds;}
+
 	void addChild(const SceneNodePtr& child);
 	void removeChild(const SceneNodePtr& child);
 
 private:
-	void updateTransform();
+	//! Flags the world transform of this node and its descendants for recalculation on next access
+	void invalidateTransform();
+
+	void resolveTransform() const
+	{
+		if (m_transformDirty)
+		{
+			updateTransform();
+		}
+	}
+
+	void updateTransform() const;
 	void setParent(const SceneNode* parent);
 
 private:
 	glm::vec3 m_position; //!< Position in parent space
 	glm::quat m_orientation; //!< Orientation in parent space
-	glm::mat4 m_cachedTransform;
+
+	// World space values derived from the above and the parent's transform.
+	// If a node is dirty then so are all of its descendants.
+	mutable glm::mat4 m_cachedTransform;
+	mutable glm::mat4 m_cachedInverseTransform;
+	mutable BoundingBox m_worldBounds;
+	mutable bool m_transformDirty;
+
+	BoundingBox m_localBounds;
 	std::vector<SceneNodePtr> m_children;
 	const SceneNode* m_parent;
 };
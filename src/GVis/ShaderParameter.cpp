@@ -34,15 +34,6 @@ ShaderParameter::ShaderParameter(const std::string& name) :
 {
 }
 
-void ShaderParameter::apply(ShaderProgram& shader)
-{
-	GLuint uniformLocation = glGetUniformLocation(shader._getProgramId(), m_name.c_str());
-	if (uniformLocation != -1)
-	{
-		apply(uniformLocation);
-	}
-}
-
 void FloatShaderParameter::apply(GLuint uniformLocation)
 {
 	glUniform1fv(uniformLocation, 1, &m_value);
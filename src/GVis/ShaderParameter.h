@@ -35,8 +35,9 @@ public:
 	ShaderParameter(const std::string& name);
 	virtual ~ShaderParameter() {};
 
+	const std::string& getName() const {return m_name;}
+
 private:
-	virtual void apply(ShaderProgram& shader);
 	virtual void apply(GLuint uniformLocation) = 0;
 
 protected:
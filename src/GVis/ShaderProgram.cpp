@@ -25,6 +25,7 @@
 
 #include <GCommon/Logger.h>
 
+#include <boost/cstdint.hpp>
 #include <boost/foreach.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
@@ -34,6 +35,8 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <cstring>
+#include <iomanip>
 #include <sstream>
 
 using namespace GCommon;
@@ -125,27 +128,76 @@ static std::string defineMacrosInGlsl(const std::vector<std::string>& macroDefin
 	return result;
 }
 
-static void compileShaderFromFile(GLuint shaderId, const std::string& shaderFilepath, const std::vector<std::string>& macroDefinitions)
+typedef std::vector<std::pair<ShaderType, std::string> > ShaderSources;
+
+static void loadShaderSources(ShaderSources& sources, const ShaderProgramConfig& config)
 {
-	defaultLogger()->logLine("Compiling shader: " + shaderFilepath);
+	std::string macros = defineMacrosInGlsl(config.macroDefinitions);
+	BOOST_FOREACH(const ShaderProgramConfig::ShaderFilepaths::value_type& value, config.shaderFilepaths)
+	{
+		std::string shaderCode;
+		loadFile(shaderCode, value.second);
+		shaderCode = preprocessIncludes(shaderCode, value.second);
+		sources.push_back(std::make_pair(value.first, macros + shaderCode));
+	}
+}
+
+//! 64 bit FNV-1a hash
+static boost::uint64_t hashBytes(const char* data, size_t size, boost::uint64_t hash = 14695981039346656037ULL)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
 
-	std::string shaderCode;
-	loadFile(shaderCode, shaderFilepath);
-	shaderCode = preprocessIncludes(shaderCode, shaderFilepath);
+static boost::uint64_t hashString(const std::string& str, boost::uint64_t hash)
+{
+	return hashBytes(str.c_str(), str.size() + 1, hash); // include terminator to separate consecutive strings
+}
 
-	shaderCode = defineMacrosInGlsl(macroDefinitions) + shaderCode;
+//! Hash of the fully preprocessed sources, including macro definitions
+static std::string createCacheKey(const ShaderSources& sources)
+{
+	boost::uint64_t hash = hashBytes(0, 0);
+	BOOST_FOREACH(const ShaderSources::value_type& source, sources)
+	{
+		int type = source.first;
+		hash = hashBytes((const char*)&type, sizeof(type), hash);
+		hash = hashString(source.second, hash);
+	}
 
-	compileShaderCode(shaderId, shaderCode);
+	std::ostringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return ss.str();
 }
 
-ShaderProgramPtr ShaderProgram::createShaderProgram(const ShaderProgramConfig& config)
+static bool checkLinkStatus(GLuint programId)
+{
+	GLint result = GL_FALSE;
+	int infoLogLength;
+	glGetProgramiv(programId, GL_LINK_STATUS, &result);
+	glGetProgramiv(programId, GL_INFO_LOG_LENGTH, &infoLogLength);
+	std::vector<char> ProgramErrorMessage( max(infoLogLength, int(1)) );
+	glGetProgramInfoLog(programId, infoLogLength, NULL, &ProgramErrorMessage[0]);
+	defaultLogger()->logLine(std::string(&ProgramErrorMessage[0]));
+	return result == GL_TRUE;
+}
+
+static GLuint compileAndLinkProgram(const ShaderProgramConfig& config, const ShaderSources& sources, bool binaryRetrievable)
 {
 	// Create the shaders
 	std::vector<GLuint> shaderIds;
-	BOOST_FOREACH(const ShaderProgramConfig::ShaderFilepaths::value_type& value, config.shaderFilepaths)
+	ShaderProgramConfig::ShaderFilepaths::const_iterator filepath = config.shaderFilepaths.begin();
+	BOOST_FOREACH(const ShaderSources::value_type& source, sources)
 	{
-		GLuint shaderId = glCreateShader(toGlShaderType(value.first));
-		compileShaderFromFile(shaderId, value.second, config.macroDefinitions);
+		defaultLogger()->logLine("Compiling shader: " + filepath->second);
+		++filepath;
+
+		GLuint shaderId = glCreateShader(toGlShaderType(source.first));
+		compileShaderCode(shaderId, source.second);
 		shaderIds.push_back(shaderId);
 	}
 
@@ -158,29 +210,252 @@ ShaderProgramPtr ShaderProgram::createShaderProgram(const ShaderProgramConfig& c
 		glAttachShader(programId, shaderId);
 	}
 
-	glLinkProgram(programId);
+	if (binaryRetrievable)
+	{
+		glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 
-	// Check the program
-	GLint result = GL_FALSE;
-	int infoLogLength;
-	glGetProgramiv(programId, GL_LINK_STATUS, &result);
-	glGetProgramiv(programId, GL_INFO_LOG_LENGTH, &infoLogLength);
-	std::vector<char> ProgramErrorMessage( max(infoLogLength, int(1)) );
-	glGetProgramInfoLog(programId, infoLogLength, NULL, &ProgramErrorMessage[0]);
-	defaultLogger()->logLine(std::string(&ProgramErrorMessage[0]));
+	glLinkProgram(programId);
+	checkLinkStatus(programId);
 
 	// Clean up
 	BOOST_FOREACH(GLuint shaderId, shaderIds)
 	{
+		glDetachShader(programId, shaderId);
 		glDeleteShader(shaderId);
 	}
 
-	return ShaderProgramPtr(new ShaderProgram(programId));
+	return programId;
+}
+
+static const char programBinaryMagic[4] = {'G', 'S', 'P', 'B'};
+
+struct ProgramBinaryHeader
+{
+	char magic[4];
+	GLenum binaryFormat;
+	GLint binaryLength;
+};
+
+static bool isProgramBinarySupported()
+{
+	if (!GLEW_ARB_get_program_binary)
+	{
+		return false;
+	}
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return formatCount > 0;
+}
+
+//! Binaries are only valid for the driver which produced them, so the driver identity is part of the filename
+static std::string getProgramBinaryFilepath(const std::string& directory, const std::string& cacheKey)
+{
+	boost::uint64_t hash = hashBytes(0, 0);
+	GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+	BOOST_FOREACH(GLenum name, names)
+	{
+		const GLubyte* str = glGetString(name);
+		if (str)
+		{
+			hash = hashString((const char*)str, hash);
+		}
+	}
+
+	std::ostringstream ss;
+	ss << cacheKey << "_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+	return (boost::filesystem::path(directory) / ss.str()).string();
+}
+
+//! @return program, or 0 if there is no valid binary at filepath
+static GLuint loadProgramBinary(const std::string& filepath)
+{
+	std::ifstream file(filepath.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return 0;
+	}
+
+	ProgramBinaryHeader header;
+	if (!file.read((char*)&header, sizeof(header)) || memcmp(header.magic, programBinaryMagic, sizeof(programBinaryMagic)) != 0 || header.binaryLength <= 0)
+	{
+		return 0;
+	}
+
+	std::vector<char> binary(header.binaryLength);
+	if (!file.read(&binary[0], binary.size()))
+	{
+		return 0;
+	}
+
+	GLuint programId = glCreateProgram();
+	glProgramBinary(programId, header.binaryFormat, &binary[0], header.binaryLength);
+
+	// Drivers reject binaries from other driver versions, in which case the program is rebuilt from source
+	GLint result = GL_FALSE;
+	glGetProgramiv(programId, GL_LINK_STATUS, &result);
+	if (result != GL_TRUE)
+	{
+		glDeleteProgram(programId);
+		return 0;
+	}
+
+	defaultLogger()->logLine("Loaded program binary: " + filepath);
+	return programId;
+}
+
+static void saveProgramBinary(GLuint programId, const std::string& filepath)
+{
+	GLint result = GL_FALSE;
+	glGetProgramiv(programId, GL_LINK_STATUS, &result);
+	if (result != GL_TRUE)
+	{
+		return;
+	}
+
+	ProgramBinaryHeader header;
+	memcpy(header.magic, programBinaryMagic, sizeof(programBinaryMagic));
+	header.binaryLength = 0;
+	glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &header.binaryLength);
+	if (header.binaryLength <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(header.binaryLength);
+	glGetProgramBinary(programId, header.binaryLength, NULL, &header.binaryFormat, &binary[0]);
+
+	try
+	{
+		boost::filesystem::create_directories(boost::filesystem::path(filepath).parent_path());
+	}
+	catch (const boost::filesystem::filesystem_error& e)
+	{
+		defaultLogger()->logLine("Could not create shader cache directory: " + std::string(e.what()));
+		return;
+	}
+
+	std::ofstream file(filepath.c_str(), std::ios::out | std::ios::binary);
+	if (file.is_open())
+	{
+		file.write((const char*)&header, sizeof(header));
+		file.write(&binary[0], binary.size());
+	}
+}
+
+typedef std::map<std::string, ShaderProgramPtr> ProgramCache;
+static ProgramCache programCache;
+static std::string programBinaryCacheDirectory;
+
+ShaderProgramPtr ShaderProgram::createShaderProgram(const ShaderProgramConfig& config)
+{
+	ShaderSources sources;
+	loadShaderSources(sources, config);
+
+	std::string cacheKey = createCacheKey(sources);
+	ProgramCache::const_iterator i = programCache.find(cacheKey);
+	if (i != programCache.end())
+	{
+		return i->second;
+	}
+
+	bool useBinaryCache = !programBinaryCacheDirectory.empty() && isProgramBinarySupported();
+	std::string binaryFilepath;
+
+	GLuint programId = 0;
+	if (useBinaryCache)
+	{
+		binaryFilepath = getProgramBinaryFilepath(programBinaryCacheDirectory, cacheKey);
+		programId = loadProgramBinary(binaryFilepath);
+	}
+
+	if (!programId)
+	{
+		programId = compileAndLinkProgram(config, sources, useBinaryCache);
+		if (useBinaryCache)
+		{
+			saveProgramBinary(programId, binaryFilepath);
+		}
+	}
+
+	ShaderProgramPtr program(new ShaderProgram(programId));
+	programCache[cacheKey] = program;
+	return program;
+}
+
+void ShaderProgram::setBinaryCacheDirectory(const std::string& directory)
+{
+	programBinaryCacheDirectory = directory;
+}
+
+void ShaderProgram::clearCache()
+{
+	programCache.clear();
 }
 
 ShaderProgram::ShaderProgram(GLuint programId) :
-	m_programId(programId)
+	m_programId(programId),
+	m_uniformBlockMask(0)
+{
+	queryActiveUniforms();
+	bindUniformBlocks();
+}
+
+GLint ShaderProgram::getUniformLocation(const std::string& name) const
 {
+	UniformLocations::const_iterator i = m_uniformLocations.find(name);
+	if (i != m_uniformLocations.end())
+	{
+		return i->second;
+	}
+	return -1;
+}
+
+void ShaderProgram::queryActiveUniforms()
+{
+	GLint uniformCount = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(m_programId, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(m_programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<char> nameBuffer(max(maxNameLength, int(1)));
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLsizei nameLength = 0;
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(m_programId, i, (GLsizei)nameBuffer.size(), &nameLength, &size, &type, &nameBuffer[0]);
+		std::string name(&nameBuffer[0], nameLength);
+
+		// Members of uniform blocks have no location
+		GLint location = glGetUniformLocation(m_programId, name.c_str());
+		if (location == -1)
+		{
+			continue;
+		}
+
+		// Arrays are reported as "name[0]", but are also addressable as "name"
+		static const std::string arraySuffix = "[0]";
+		if (name.size() > arraySuffix.size() && name.compare(name.size() - arraySuffix.size(), arraySuffix.size(), arraySuffix) == 0)
+		{
+			m_uniformLocations[name.substr(0, name.size() - arraySuffix.size())] = location;
+		}
+		m_uniformLocations[name] = location;
+	}
+}
+
+void ShaderProgram::bindUniformBlocks()
+{
+	for (int binding = 0; binding < UniformBlockBindingCount; binding++)
+	{
+		GLuint blockIndex = glGetUniformBlockIndex(m_programId, getUniformBlockName(UniformBlockBinding(binding)));
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(m_programId, blockIndex, binding);
+			m_uniformBlockMask |= (1 << binding);
+		}
+	}
 }
 
 } // namespace GVis
@@ -22,6 +22,7 @@
 
 #include "GVisFwd.h"
 #include "Math.h"
+#include "UniformBlocks.h"
 
 #include <GCommon/GCommonFwd.h>
 
@@ -61,15 +62,41 @@ struct ShaderProgramConfig
 class ShaderProgram
 {
 public:
+	/*! Programs are cached by a hash of their preprocessed sources and macro definitions,
+		so configs which produce identical sources share one program.
+	*/
 	static ShaderProgramPtr createShaderProgram(const ShaderProgramConfig& config);
 
+	/*! Enables caching of linked program binaries in directory, which is created if needed.
+		Binaries which the driver rejects are rebuilt from source. Empty (the default) disables the disk cache.
+	*/
+	static void setBinaryCacheDirectory(const std::string& directory);
+
+	//! Releases cached programs. Call if the GL context the programs were created in is replaced.
+	static void clearCache();
+
 	GLuint _getProgramId() const {return m_programId;}
 
+	//! Looks up the location table built when the program was linked
+	//! @return -1 if name is not an active uniform in the default block
+	GLint getUniformLocation(const std::string& name) const;
+
+	//! @return true if the program declares the block, in which case it is bound to the binding point
+	bool hasUniformBlock(UniformBlockBinding binding) const {return (m_uniformBlockMask & (1 << binding)) != 0;}
+
 protected:
 	ShaderProgram(GLuint programId);
 
+private:
+	void queryActiveUniforms();
+	void bindUniformBlocks();
+
 private:
 	GLuint m_programId;
+
+	typedef std::map<std::string, GLint> UniformLocations;
+	UniformLocations m_uniformLocations;
+	int m_uniformBlockMask;
 };
 
 } // namespace GVis
@@ -81,6 +81,7 @@ ShadowProjector::ShadowProjector(const ShadowProjectorConfig& projectorConfig) :
 		config.techniqueCategory = TechniqueCategory_DepthRtt;
 
 		m_target.reset(new RenderTextureTarget(config));
+		m_target->setName("Shadow");
 	}
 
 	// Create projector camera
@@ -23,19 +23,23 @@
 #include "ShaderProgram.h"
 #include "ShaderParameter.h"
 #include "Camera.h"
-#include "Light.h"
-#include "ShadowProjector.h"
 #include "Convert.h"
+#include "UniformBlocks.h"
+
+#include <boost/foreach.hpp>
 
 #include <assert.h>
 
 namespace GVis {
 
+int Technique::ms_nextSortId = 0;
+
 Technique::Technique(const ShaderProgramPtr& shader) :
 	m_shader(shader),
 	m_alphaBlendingMode(AlphaBlendingMode_None),
 	m_alphaToCoverageEnabled(false),
-	m_depthCheckEnabled(true)
+	m_depthCheckEnabled(true),
+	m_sortId(ms_nextSortId++)
 {
 	assert(m_shader);
 
@@ -77,17 +81,24 @@ Technique::Technique(const ShaderProgramPtr& shader) :
 
 	m_viewportResolution.reset(new Vec2ShaderParameter("viewportResolution", glm::vec2(0)));
 	m_parameters.push_back(m_viewportResolution);
+
+	BOOST_FOREACH(const ShaderParameterPtr& parameter, m_parameters)
+	{
+		m_parameterLocations.push_back(m_shader->getUniformLocation(parameter->getName()));
+	}
 }
 
 void Technique::addTextureUnit(const TextureUnit& unit)
 {
 	assert(unit.texture);
 	m_textureUnits.push_back(unit);
+	m_textureUnitLocations.push_back(m_shader->getUniformLocation(unit.samplerName));
 }
 
-void Technique::applyState()
+void Technique::applyState(const Technique* previous)
 {
 	// Set alpha blending mode
+	if (!previous || previous->m_alphaBlendingMode != m_alphaBlendingMode)
 	{
 		switch (m_alphaBlendingMode)
 		{
@@ -107,27 +118,37 @@ void Technique::applyState()
 		}
 	}
 
-	if (m_depthCheckEnabled)
+	if (!previous || previous->m_depthCheckEnabled != m_depthCheckEnabled)
 	{
-		glDepthFunc(GL_LESS);
+		if (m_depthCheckEnabled)
+		{
+			glDepthFunc(GL_LESS);
+		}
+		else
+		{
+			glDepthFunc(GL_ALWAYS);
+		}
 	}
-	else
-	{
-		glDepthFunc(GL_ALWAYS);
-	}	
 	
-	if (m_alphaToCoverageEnabled)
+	if (!previous || previous->m_alphaToCoverageEnabled != m_alphaToCoverageEnabled)
 	{
-		glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
-	}
-	else
-	{
-		glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+		if (m_alphaToCoverageEnabled)
+		{
+			glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+		}
+		else
+		{
+			glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+		}
 	}
 
 	// Use shader
 	GLint programId = m_shader->_getProgramId();
-	glUseProgram(programId);
+	bool sameProgram = previous && previous->m_shader == m_shader;
+	if (!sameProgram)
+	{
+		glUseProgram(programId);
+	}
 
 	// Set textures
 	{
@@ -135,12 +156,26 @@ void Technique::applyState()
 		count = m_textureUnits.size();
 		for (int i = 0; i < count; i++)
 		{
-			glActiveTexture(GL_TEXTURE0 + i);
 			const TextureUnit& unit = m_textureUnits[i];
+
+			// Sampler uniforms are program state, so a unit can only be skipped if the program is unchanged
+			if (sameProgram && i < (int)previous->m_textureUnits.size())
+			{
+				const TextureUnit& previousUnit = previous->m_textureUnits[i];
+				if (previousUnit.texture == unit.texture && previousUnit.samplerName == unit.samplerName)
+				{
+					continue;
+				}
+			}
+
+			glActiveTexture(GL_TEXTURE0 + i);
 			glBindTexture(toGlTargetType(unit.texture->getType()), unit.texture->_getGlTextureId());
 
-			GLuint uniformLocation = glGetUniformLocation(programId, unit.samplerName.c_str());
-			glUniform1i(uniformLocation, i);
+			GLint uniformLocation = m_textureUnitLocations[i];
+			if (uniformLocation != -1)
+			{
+				glUniform1i(uniformLocation, i);
+			}
 		}
 	}
 
@@ -149,69 +184,55 @@ void Technique::applyState()
 		int count = (int)m_parameters.size();
 		for (int i = 0; i < count; i++)
 		{
-			m_parameters[i]->apply(*m_shader);
+			GLint uniformLocation = m_parameterLocations[i];
+			if (uniformLocation != -1)
+			{
+				m_parameters[i]->apply(uniformLocation);
+			}
 		}
 	}
 }
 
 void Technique::updateShaderParameters(const RenderContext& context)
 {
-	m_viewportResolution->setValue(context.viewportResolution);
-
-	ProjectionPtr projection = context.camera->getProjection();
-	m_farClipDistance->setValue(projection->getFarClipDistance());
-	m_maxClipSpaceDepth->setValue(projection->getMaxClipSpaceDepth());
-
-	glm::mat4 viewProj = context.camera->getViewProjectionMatrix();
-	m_viewProjectionMatrix->setValue(viewProj);
-
-	m_modelViewProjectionMatrix->setValue(viewProj * context.sceneNode->getTransform());
-
-	glm::mat4 invModelMatrix = glm::inverse(context.sceneNode->getTransform());
-	m_invModelMatrix->setValue(invModelMatrix);
-	{ // camera
-		glm::vec4 v = invModelMatrix * glm::vec4(context.camera->getPosition(), 1);
-		glm::vec3 pos(v.x, v.y, v.z);
-		m_cameraPosition_modelSpace->setValue(pos);
-		m_cameraDirection_modelSpace->setValue(glm::normalize(pos));
-		m_cameraForwardDirection_modelSpace->setValue(glm::mat3(invModelMatrix) * context.camera->getDirection());
-	}
-	
-
-	if (context.light)
+	FrameUniformBlock computedFrameUniforms;
+	const FrameUniformBlock* frameUniforms = context.frameUniforms;
+	if (!frameUniforms)
 	{
-		glm::vec3 dir = glm::inverse(context.sceneNode->getOrientation()) * context.light->getDirection();
-		m_lightDirection_modelSpace->setValue(-dir); // light direction in shader is direction to light
-
-		const ShadowProjector* projector = context.light->getShadowProjector();
-		if (projector)
-		{
-			static glm::mat4 biasMatrix(
-				0.5, 0.0, 0.0, 0.0, 
-				0.0, 0.5, 0.0, 0.0,
-				0.0, 0.0, 0.5, 0.0,
-				0.5, 0.5, 0.5, 1.0
-			);
-
-			glm::mat4 shadowModelViewProj = projector->getCamera()->getViewProjectionMatrix() * context.sceneNode->getTransform();
-
-			m_shadowModelViewProjectionMatrix->setValue(biasMatrix * shadowModelViewProj);
-
-			m_shadowMaxClipSpaceDepth->setValue(projector->getCamera()->getProjection()->getMaxClipSpaceDepth());
-
-			m_invShadowViewProjectionMatrix->setValue(glm::inverse(biasMatrix * projector->getCamera()->getViewProjectionMatrix()));
-		}
+		computeFrameUniformBlock(computedFrameUniforms, *context.camera, context.viewportResolution);
+		frameUniforms = &computedFrameUniforms;
 	}
-	else
+
+	ObjectUniformBlock computedObjectUniforms;
+	const ObjectUniformBlock* objectUniforms = context.objectUniforms;
+	if (!objectUniforms)
 	{
-		m_lightDirection_modelSpace->setValue(vec3Zero());
+		computeObjectUniformBlock(computedObjectUniforms, context);
+		objectUniforms = &computedObjectUniforms;
 	}
+
+	// Programs reading these from uniform blocks have no locations for them, so setting them here only costs a copy
+	m_viewportResolution->setValue(frameUniforms->viewportResolution);
+	m_farClipDistance->setValue(frameUniforms->farClipDistance);
+	m_maxClipSpaceDepth->setValue(frameUniforms->maxClipSpaceDepth);
+	m_viewProjectionMatrix->setValue(frameUniforms->viewProj);
+
+	m_modelViewProjectionMatrix->setValue(objectUniforms->modelViewProj);
+	m_invModelMatrix->setValue(objectUniforms->invModelMat);
+	m_cameraPosition_modelSpace->setValue(objectUniforms->cameraPosition_modelSpace);
+	m_cameraDirection_modelSpace->setValue(objectUniforms->cameraDirection_modelSpace);
+	m_cameraForwardDirection_modelSpace->setValue(objectUniforms->cameraForwardDirection_modelSpace);
+	m_lightDirection_modelSpace->setValue(objectUniforms->lightDirection_modelSpace);
+	m_shadowModelViewProjectionMatrix->setValue(objectUniforms->shadowModelViewProj);
+	m_shadowMaxClipSpaceDepth->setValue(objectUniforms->shadowMaxClipSpaceDepth);
+	m_invShadowViewProjectionMatrix->setValue(objectUniforms->invShadowViewProj);
 }
 
 void Technique::addCustomShaderParameter(const ShaderParameterPtr& parameter)
 {
 	assert(parameter);
 	m_parameters.push_back(parameter);
+	m_parameterLocations.push_back(m_shader->getUniformLocation(parameter->getName()));
 }
 
 void Technique::setAlphaBlendingMode(AlphaBlendingMode mode)
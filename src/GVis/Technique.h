@@ -54,7 +54,11 @@ public:
 
 	void addTextureUnit(const TextureUnit& unit);
 
-	void applyState();
+	/*! Binds the blend, depth, program and texture state and applies shader parameters.
+		@param previous is the technique applied immediately before this one with no other GL state changes in between.
+		State which matches previous is not set again. Can be null.
+	*/
+	void applyState(const Technique* previous = 0);
 
 	//! Light can be null
 	virtual void updateShaderParameters(const RenderContext& context);
@@ -65,6 +69,11 @@ public:
 
 	void addCustomShaderParameter(const ShaderParameterPtr& parameter);
 
+	const ShaderProgramPtr& _getShader() const {return m_shader;}
+
+	//! Unique per technique, increasing in order of creation. Used for render queue state sorting.
+	int _getSortId() const {return m_sortId;}
+
 protected:
 	FloatShaderParameterPtr m_farClipDistance;
 	FloatShaderParameterPtr m_maxClipSpaceDepth;
@@ -87,7 +96,12 @@ private:
 	bool m_depthCheckEnabled;
 
 	std::vector<ShaderParameterPtr> m_parameters;
+	std::vector<GLint> m_parameterLocations; //!< Resolved when each parameter is added. -1 if the shader doesn't use it.
 	std::vector<TextureUnit> m_textureUnits;
+	std::vector<GLint> m_textureUnitLocations;
+
+	int m_sortId;
+	static int ms_nextSortId;
 };
 
 } // namespace GVis
@@ -19,6 +19,7 @@
 // THE SOFTWARE.
 
 #include "Texture.h"
+#include "PixelUnpackBuffer.h"
 #include "TextureBufferObject.h"
 #include "Convert.h"
 
@@ -45,12 +46,27 @@ bool isCompressed(PixelFormat format)
 	case PixelFormat_DXT3_SRGB_ALPHA:
 	case PixelFormat_DXT5:
 	case PixelFormat_DXT5_SRGB_ALPHA:
+	case PixelFormat_BC4:
+	case PixelFormat_BC5:
 		return true;
 	}
 
 	return false;
 }
 
+//! @return size of a 4x4 compressed block
+static int getCompressedBlockSizeBytes(PixelFormat format)
+{
+	switch(format)
+	{
+	case PixelFormat_DXT1:
+	case PixelFormat_DXT1_SRGB_ALPHA:
+	case PixelFormat_BC4:
+		return 8;
+	}
+	return 16;
+}
+
 void getUncompressedPixelFormatInfo(PixelFormatInfo& info, PixelFormat format)
 {
 	assert(!isCompressed(format));
@@ -67,6 +83,11 @@ void getUncompressedPixelFormatInfo(PixelFormatInfo& info, PixelFormat format)
 		info.pixelSizeBytes = 2;
 		info.componentDataType = GL_UNSIGNED_SHORT;
 		break;
+	case PixelFormat_R16F:
+		info.glFormat = GL_RED;
+		info.pixelSizeBytes = 2;
+		info.componentDataType = GL_HALF_FLOAT;
+		break;
 	case PixelFormat_RGB8:
 	case PixelFormat_SRGB8:
 		info.glFormat = GL_RGB;
@@ -119,6 +140,8 @@ int getGlInternalPixelFormat(PixelFormat format)
 		return GL_R8;
 	case PixelFormat_R16:
 		return GL_R16;
+	case PixelFormat_R16F:
+		return GL_R16F;
 	case PixelFormat_RGB8:
 		return GL_RGB8;
 	case PixelFormat_SRGB8:
@@ -147,6 +170,10 @@ int getGlInternalPixelFormat(PixelFormat format)
 		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
 	case PixelFormat_DXT5_SRGB_ALPHA:
 		return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+	case PixelFormat_BC4:
+		return GL_COMPRESSED_RED_RGTC1;
+	case PixelFormat_BC5:
+		return GL_COMPRESSED_RG_RGTC2;
 	default:
 		throw std::runtime_error("Invalid pixel format: " + boost::lexical_cast<std::string>(format));
 	}
@@ -159,6 +186,13 @@ int getByteSizeofPixel(PixelFormat format)
 	return info.pixelSizeBytes;
 }
 
+int getMax3dTextureSize()
+{
+	GLint size = 0;
+	glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &size);
+	return size;
+}
+
 GLenum getGlComponentDataType(PixelFormat format)
 {
 	PixelFormatInfo info;
@@ -171,13 +205,8 @@ int getImageSizeBytes(int width, int height, int depth, PixelFormat format)
 {
 	if (isCompressed(format))
 	{
-		if (depth > 1)
-		{
-			throw std::runtime_error("3D Compressed textures not supported");
-		}
-
-		int blockSize = (format == PixelFormat_DXT1 || format == PixelFormat_DXT1_SRGB_ALPHA) ? 8 : 16;
-		return ((width+3)/4)*((height+3)/4)*blockSize;
+		// Layers of a 2d array texture are compressed independently
+		return ((width+3)/4)*((height+3)/4)*getCompressedBlockSizeBytes(format)*std::max(1, depth);
 	}
 	else
 	{
@@ -185,46 +214,75 @@ int getImageSizeBytes(int width, int height, int depth, PixelFormat format)
 	}
 }
 
+//! @return number of levels in a full mip chain
+static int getFullMipmapCount(int width, int height, int depth)
+{
+	int size = std::max(width, std::max(height, depth));
+	int count = 1;
+	while (size > 1)
+	{
+		size /= 2;
+		++count;
+	}
+	return count;
+}
+
+static GLint toGlMinFilter(TextureFilter filter, bool mipmapped)
+{
+	switch (filter)
+	{
+	case TextureFilter_Nearest:
+		return mipmapped ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
+	case TextureFilter_Bilinear:
+		return mipmapped ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR;
+	case TextureFilter_Trilinear:
+		return mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+	default:
+		assert(0);
+	}
+	return GL_LINEAR;
+}
+
 Texture::Texture(const ImageTextureConfig& config) :
 	m_width(config.width),
 	m_height(config.height),
 	m_depth(config.depth)
 {
-	m_type = config.is3d ? TextureType_3d : TextureType_2d;
+	if (config.is2dArray)
+	{
+		m_type = TextureType_2dArray;
+	}
+	else
+	{
+		m_type = config.is3d ? TextureType_3d : TextureType_2d;
+	}
 
 	assert(m_width > 0);
 	assert(m_height > 0);
-	assert(!config.is3d || m_depth > 0);
+	assert(m_type == TextureType_2d || m_depth > 0);
 
 	GLenum target = toGlTargetType(m_type);
 
+	bool compressed = isCompressed(config.format);
+	if (compressed && target == GL_TEXTURE_3D)
+	{
+		// No compressed formats supported here are defined for 3d targets. Store 3d data as a 2d array instead.
+		throw std::runtime_error("Compressed pixel format " + boost::lexical_cast<std::string>(config.format) + " is not supported for 3d textures");
+	}
+
 	glGenTextures(1, &m_textureId);
 
 	glBindTexture(target, m_textureId);
 
-	int loadableMipmapCount = config.manualMipmapCount ? std::max(1, *config.manualMipmapCount) : 1;
+	bool generateMipmaps = !config.manualMipmapCount;
+	int loadableMipmapCount = generateMipmaps ? 1 : std::max(1, *config.manualMipmapCount);
+	int levelCount = generateMipmaps ? getFullMipmapCount(m_width, m_height, (target == GL_TEXTURE_3D) ? m_depth : 1) : loadableMipmapCount;
 
-	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-
-	if (config.filter == TextureFilter_Nearest)
-	{
-		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	}
-	else if (config.filter == TextureFilter_Bilinear)
-	{
-		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	}
-	else
-	{
-		assert(0);
-	}
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, toGlMinFilter(config.filter, levelCount > 1));
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, (config.filter == TextureFilter_Nearest) ? GL_NEAREST : GL_LINEAR);
 
 	glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);  //Always set the base and max mipmap levels of a texture.
-	
-	if (config.manualMipmapCount)
-	{
-		glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, loadableMipmapCount - 1);
-	}
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
 
 	setTextureAddressMode(config.textureAddressMode);
 
@@ -232,14 +290,30 @@ Texture::Texture(const ImageTextureConfig& config) :
 
 	glPixelStorei(GL_UNPACK_ALIGNMENT,1);
 
-
-	bool compressed = isCompressed(config.format);
 	if (!compressed)
 	{
 		m_glPixelFormat = getGlPixelFormat(config.format);
 		m_componentDataType = getGlComponentDataType(config.format);
 	}
 
+	// Allocate every level up front as immutable storage where supported
+	bool immutable = GLEW_ARB_texture_storage != 0;
+	if (immutable)
+	{
+		if (target == GL_TEXTURE_2D)
+		{
+			glTexStorage2D(target, levelCount, internalFormat, m_width, m_height);
+		}
+		else if (target == GL_TEXTURE_3D || target == GL_TEXTURE_2D_ARRAY)
+		{
+			glTexStorage3D(target, levelCount, internalFormat, m_width, m_height, m_depth);
+		}
+		else
+		{
+			assert(0);
+		}
+	}
+
 	// Load each mipmap level
 	int width = m_width;
 	int height = m_height;
@@ -249,9 +323,35 @@ Texture::Texture(const ImageTextureConfig& config) :
 	{
 		int pixelSizeBytes = getImageSizeBytes(width, height, depth, config.format);
 
-		if (target == GL_TEXTURE_2D)
+		if (immutable)
 		{
-			if (isCompressed(config.format))
+			// Contents of storage without data are undefined, as with glTexImage and null data
+			if (config.data)
+			{
+				if (target == GL_TEXTURE_2D)
+				{
+					if (compressed)
+					{
+						glCompressedTexSubImage2D(target, level, 0, 0, width, height, internalFormat, pixelSizeBytes, config.data + offset);
+					}
+					else
+					{
+						glTexSubImage2D(target, level, 0, 0, width, height, *m_glPixelFormat, *m_componentDataType, config.data + offset);
+					}
+				}
+				else if (compressed)
+				{
+					glCompressedTexSubImage3D(target, level, 0, 0, 0, width, height, depth, internalFormat, pixelSizeBytes, config.data + offset);
+				}
+				else
+				{
+					glTexSubImage3D(target, level, 0, 0, 0, width, height, depth, *m_glPixelFormat, *m_componentDataType, config.data + offset);
+				}
+			}
+		}
+		else if (target == GL_TEXTURE_2D)
+		{
+			if (compressed)
 			{
 				glCompressedTexImage2D(target, level, internalFormat, width, height, 0, pixelSizeBytes, config.data + offset); 
 			}
@@ -260,9 +360,16 @@ Texture::Texture(const ImageTextureConfig& config) :
 				glTexImage2D(target, level, internalFormat, width, height, 0, *m_glPixelFormat, *m_componentDataType, config.data + offset);
 			}
 		}
-		else if (target == GL_TEXTURE_3D)
+		else if (target == GL_TEXTURE_3D || target == GL_TEXTURE_2D_ARRAY)
 		{
-			glTexImage3D(target, level, internalFormat, width, height, depth, 0, *m_glPixelFormat, *m_componentDataType, config.data + offset);
+			if (compressed)
+			{
+				glCompressedTexImage3D(target, level, internalFormat, width, height, depth, 0, pixelSizeBytes, config.data + offset);
+			}
+			else
+			{
+				glTexImage3D(target, level, internalFormat, width, height, depth, 0, *m_glPixelFormat, *m_componentDataType, config.data + offset);
+			}
 		}
 		else
 		{
@@ -278,7 +385,7 @@ Texture::Texture(const ImageTextureConfig& config) :
 		}
 	}
 
-	if (!config.manualMipmapCount)
+	if (generateMipmaps)
 	{
 		glGenerateMipmap(target);
 	}
@@ -317,4 +424,38 @@ void Texture::setTextureAddressMode(TextureAddressMode mode)
 	glTexParameteri(target, GL_TEXTURE_WRAP_R, wrapMode);
 }
 
+void Texture::setSubImage(int x, int y, int z, int width, int height, int depth, const void* data)
+{
+	assert(m_glPixelFormat && m_componentDataType);
+	assert(x >= 0 && y >= 0 && z >= 0);
+	assert(x + width <= m_width && y + height <= m_height && z + depth <= m_depth);
+
+	GLenum target = toGlTargetType(m_type);
+	glBindTexture(target, m_textureId);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	if (target == GL_TEXTURE_2D)
+	{
+		assert(z == 0 && depth == 1);
+		glTexSubImage2D(target, 0, x, y, width, height, *m_glPixelFormat, *m_componentDataType, data);
+	}
+	else if (target == GL_TEXTURE_3D || target == GL_TEXTURE_2D_ARRAY)
+	{
+		glTexSubImage3D(target, 0, x, y, z, width, height, depth, *m_glPixelFormat, *m_componentDataType, data);
+	}
+	else
+	{
+		assert(0);
+	}
+	glBindTexture(target, 0);
+}
+
+void Texture::setSubImage(int x, int y, int z, int width, int height, int depth, const PixelUnpackBuffer& buffer, size_t offsetBytes)
+{
+	// With a pixel unpack buffer bound, the data pointer is an offset into the buffer
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer._getGlBufferId());
+	setSubImage(x, y, z, width, height, depth, reinterpret_cast<const void*>(offsetBytes));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
 } // namespace GVis
@@ -30,6 +30,7 @@ enum PixelFormat
 {
 	PixelFormat_R8,
 	PixelFormat_R16,
+	PixelFormat_R16F,
 	PixelFormat_RGB8,
 	PixelFormat_SRGB8,
 	PixelFormat_RGBA8,
@@ -44,12 +45,15 @@ enum PixelFormat
 	PixelFormat_DXT3_SRGB_ALPHA,
 	PixelFormat_DXT5,
 	PixelFormat_DXT5_SRGB_ALPHA,
+	PixelFormat_BC4, //!< Single channel RGTC. 2d and 2d array textures only.
+	PixelFormat_BC5, //!< Two channel RGTC. 2d and 2d array textures only.
 };
 
 enum TextureType
 {
 	TextureType_2d,
 	TextureType_3d,
+	TextureType_2dArray,
 	TextureType_Buffer
 };
 
@@ -62,7 +66,8 @@ enum TextureAddressMode
 enum TextureFilter
 {
 	TextureFilter_Nearest,
-	TextureFilter_Bilinear,
+	TextureFilter_Bilinear, //!< Linear within a mip level, nearest between levels
+	TextureFilter_Trilinear, //!< Linear within and between mip levels. Same as bilinear for textures without mipmaps.
 };
 
 struct ImageTextureConfig
@@ -74,19 +79,25 @@ struct ImageTextureConfig
 		c.height = 512;
 		c.depth = 1;
 		c.is3d = false;
+		c.is2dArray = false;
 		c.format = PixelFormat_RGBA8;
 		c.textureAddressMode = TextureAddressMode_Wrap;
 		c.data = 0; // texture will be blank
-		c.manualMipmapCount = 0;
+		c.manualMipmapCount = 0; // no mipmaps
 		c.filter = TextureFilter_Bilinear;
 		return c;
 	}
 
 	int width;
 	int height;
-	int depth; //! For 3d textures
+	int depth; //! For 3d textures, or number of layers for 2d array textures
 	bool is3d;
-	boost::optional<int> manualMipmapCount; //! Mipmaps will be generated manualMipmapCount is not specified
+	//! Creates an array of depth 2d layers, which are not filtered between. Takes precedence over is3d.
+	//! Use for 3d data in formats only defined for 2d targets, such as block compressed formats.
+	bool is2dArray;
+	//! Number of mip levels supplied in data, largest first. 0 or 1 gives a single level without mipmaps.
+	//! If not specified, a full mip chain is allocated and generated from level 0.
+	boost::optional<int> manualMipmapCount;
 	PixelFormat format;
 	TextureAddressMode textureAddressMode;
 	TextureFilter filter;
@@ -123,6 +134,13 @@ public:
 
 	void setTextureAddressMode(TextureAddressMode mode);
 
+	//! Replaces a region of mipmap level 0. Only valid for uncompressed 2d, 3d and 2d array textures.
+	//! For 2d textures, z must be 0 and depth must be 1. For 2d array textures, z and depth select layers.
+	void setSubImage(int x, int y, int z, int width, int height, int depth, const void* data);
+
+	//! As above, but copies from offsetBytes into buffer on the GPU. buffer must not be mapped.
+	void setSubImage(int x, int y, int z, int width, int height, int depth, const PixelUnpackBuffer& buffer, size_t offsetBytes);
+
 protected:
 	GLuint m_textureId;
 	int m_width;
@@ -141,4 +159,10 @@ protected:
 
 extern int getByteSizeofPixel(PixelFormat format);
 
+//! Returns the size of one mip level of an image, including block compressed formats
+extern int getImageSizeBytes(int width, int height, int depth, PixelFormat format);
+
+//! Returns the maximum width, height and depth of a 3d texture supported by the GL implementation
+extern int getMax3dTextureSize();
+
 } // namespace GVis
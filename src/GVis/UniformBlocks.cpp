@@ -0,0 +1,101 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "UniformBlocks.h"
+#include "Camera.h"
+#include "Light.h"
+#include "Projection.h"
+#include "RenderContext.h"
+#include "SceneNode.h"
+#include "ShadowProjector.h"
+
+#include <assert.h>
+
+namespace GVis {
+
+const char* getUniformBlockName(UniformBlockBinding binding)
+{
+	switch (binding)
+	{
+	case UniformBlockBinding_Frame:
+		return "FrameUniforms";
+	case UniformBlockBinding_Object:
+		return "ObjectUniforms";
+	default:
+		assert(!"Invalid uniform block binding");
+	}
+	return "";
+}
+
+void computeFrameUniformBlock(FrameUniformBlock& block, const Camera& camera, const glm::vec2& viewportResolution)
+{
+	ProjectionPtr projection = camera.getProjection();
+	block.viewProj = camera.getViewProjectionMatrix();
+	block.viewportResolution = viewportResolution;
+	block.farClipDistance = projection->getFarClipDistance();
+	block.maxClipSpaceDepth = projection->getMaxClipSpaceDepth();
+}
+
+void computeObjectUniformBlock(ObjectUniformBlock& block, const RenderContext& context)
+{
+	const glm::mat4& modelMatrix = context.sceneNode->getTransform();
+	const glm::mat4& invModelMatrix = context.sceneNode->getInverseTransform();
+
+	block.modelViewProj = context.camera->getViewProjectionMatrix() * modelMatrix;
+	block.invModelMat = invModelMatrix;
+
+	glm::vec3 pos(invModelMatrix * glm::vec4(context.camera->getPosition(), 1));
+	block.cameraPosition_modelSpace = pos;
+	block.cameraDirection_modelSpace = glm::normalize(pos);
+	block.cameraForwardDirection_modelSpace = glm::mat3(invModelMatrix) * context.camera->getDirection();
+
+	block.shadowModelViewProj = glm::mat4(1);
+	block.invShadowViewProj = glm::mat4(1);
+	block.shadowMaxClipSpaceDepth = 0;
+	block.padding0 = block.padding1 = block.padding2 = 0;
+
+	if (context.light)
+	{
+		glm::vec3 dir = glm::mat3(invModelMatrix) * context.light->getDirection();
+		block.lightDirection_modelSpace = -dir; // light direction in shader is direction to light
+
+		const ShadowProjector* projector = context.light->getShadowProjector();
+		if (projector)
+		{
+			static glm::mat4 biasMatrix(
+				0.5, 0.0, 0.0, 0.0, 
+				0.0, 0.5, 0.0, 0.0,
+				0.0, 0.0, 0.5, 0.0,
+				0.5, 0.5, 0.5, 1.0
+			);
+
+			glm::mat4 shadowViewProj = biasMatrix * projector->getCamera()->getViewProjectionMatrix();
+			block.shadowModelViewProj = shadowViewProj * modelMatrix;
+			block.shadowMaxClipSpaceDepth = projector->getCamera()->getProjection()->getMaxClipSpaceDepth();
+			block.invShadowViewProj = glm::inverse(shadowViewProj);
+		}
+	}
+	else
+	{
+		block.lightDirection_modelSpace = vec3Zero();
+	}
+}
+
+} // namespace GVis
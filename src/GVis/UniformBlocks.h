@@ -0,0 +1,71 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "GVisFwd.h"
+#include "Math.h"
+
+namespace GVis {
+
+//! Binding points of the built-in std140 uniform blocks. Programs declaring a block are bound to these at link time.
+enum UniformBlockBinding
+{
+	UniformBlockBinding_Frame, //!< FrameUniforms
+	UniformBlockBinding_Object, //!< ObjectUniforms
+	UniformBlockBindingCount
+};
+
+//! @return name of the block in GLSL
+const char* getUniformBlockName(UniformBlockBinding binding);
+
+//! Mirrors FrameUniforms in Shaders/Common/FrameUniforms.h. Constant for all draws rendered with one camera and viewport.
+struct FrameUniformBlock
+{
+	glm::mat4 viewProj;
+	glm::vec2 viewportResolution;
+	float farClipDistance;
+	float maxClipSpaceDepth;
+};
+
+//! Mirrors ObjectUniforms in Shaders/Common/ObjectUniforms.h. Constant for all renderables of one node.
+//! vec3 members are padded to 16 bytes as required by std140.
+struct ObjectUniformBlock
+{
+	glm::mat4 modelViewProj;
+	glm::mat4 invModelMat;
+	glm::mat4 shadowModelViewProj;
+	glm::mat4 invShadowViewProj;
+	glm::vec3 cameraPosition_modelSpace;
+	float padding0;
+	glm::vec3 cameraDirection_modelSpace; //!< direction to camera
+	float padding1;
+	glm::vec3 cameraForwardDirection_modelSpace; //!< direction of camera
+	float padding2;
+	glm::vec3 lightDirection_modelSpace; //!< direction to light
+	float shadowMaxClipSpaceDepth;
+};
+
+void computeFrameUniformBlock(FrameUniformBlock& block, const Camera& camera, const glm::vec2& viewportResolution);
+
+//! Uses the scene node, camera and light of context. Light can be null.
+void computeObjectUniformBlock(ObjectUniformBlock& block, const RenderContext& context);
+
+} // namespace GVis
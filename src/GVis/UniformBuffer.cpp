@@ -0,0 +1,82 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "UniformBuffer.h"
+
+#include <GL/glew.h>
+
+#include <assert.h>
+
+namespace GVis {
+
+UniformBuffer::UniformBuffer() :
+	m_ubo(0),
+	m_sizeBytes(0)
+{
+}
+
+UniformBuffer::~UniformBuffer()
+{
+	if (m_ubo)
+	{
+		glDeleteBuffers(1, &m_ubo);
+	}
+}
+
+void UniformBuffer::setData(const void* data, size_t sizeBytes)
+{
+	if (!m_ubo)
+	{
+		glGenBuffers(1, &m_ubo);
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeBytes, data, GL_STREAM_DRAW);
+	m_sizeBytes = sizeBytes;
+}
+
+void UniformBuffer::bindBase(GLuint bindingPoint) const
+{
+	assert(m_ubo);
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_ubo);
+}
+
+void UniformBuffer::bindRange(GLuint bindingPoint, size_t offsetBytes, size_t sizeBytes) const
+{
+	assert(m_ubo);
+	assert(offsetBytes + sizeBytes <= m_sizeBytes);
+	glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, m_ubo, offsetBytes, sizeBytes);
+}
+
+size_t UniformBuffer::getOffsetAlignment()
+{
+	static GLint alignment = 0;
+	if (!alignment)
+	{
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		if (alignment <= 0)
+		{
+			alignment = 256;
+		}
+	}
+	return size_t(alignment);
+}
+
+} // namespace GVis
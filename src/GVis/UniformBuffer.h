@@ -0,0 +1,50 @@
+// Copyright (c) 2013-2014 Matthew Paul Reid
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include "GVisFwd.h"
+
+namespace GVis {
+
+//! Buffer backing std140 uniform blocks. The GL buffer is created on first upload.
+class UniformBuffer
+{
+public:
+	UniformBuffer();
+	~UniformBuffer();
+
+	//! Replaces the whole buffer contents. Storage is orphaned so the driver need not wait for draws using the old contents.
+	void setData(const void* data, size_t sizeBytes);
+
+	void bindBase(GLuint bindingPoint) const;
+
+	//! @param offsetBytes must be a multiple of getOffsetAlignment()
+	void bindRange(GLuint bindingPoint, size_t offsetBytes, size_t sizeBytes) const;
+
+	//! @return required alignment of offsets passed to bindRange
+	static size_t getOffsetAlignment();
+
+private:
+	GLuint m_ubo;
+	size_t m_sizeBytes;
+};
+
+} // namespace GVis
@@ -26,10 +26,18 @@
 #include "Viewport.h"
 #include "Geo.h"
 #include "Camera.h"
+#include "FrameProfiler.h"
+#include "Frustum.h"
+#include "Renderable.h"
+#include "ShaderProgram.h"
+#include "Technique.h"
+#include "UniformBlocks.h"
+#include "UniformBuffer.h"
 
 #include <GCommon/VectorHelper.h>
 
 #include <boost/foreach.hpp>
+#include <sstream>
 #include <stdexcept>
 
 using namespace GCommon;
@@ -39,7 +47,10 @@ namespace GVis {
 float VisSystem::ms_maxLightSearchRange = 100000000;
 
 VisSystem::VisSystem() :
-	m_wireframeModeEnabled(false)
+	m_wireframeModeEnabled(false),
+	m_frustumCullingEnabled(true),
+	m_frameUniformBuffer(new UniformBuffer),
+	m_objectUniformBuffer(new UniformBuffer)
 {
 	if(!glfwInit())
 	{
@@ -49,6 +60,9 @@ VisSystem::VisSystem() :
 
 VisSystem::~VisSystem()
 {
+	m_frameUniformBuffer.reset();
+	m_objectUniformBuffer.reset();
+	m_profiler.reset();
 	glfwTerminate();
 }
 
@@ -56,7 +70,29 @@ void VisSystem::render() const
 {
 	if (m_rootRenderTarget)
 	{
+		if (m_profiler)
+		{
+			m_profiler->beginFrame();
+		}
+
 		m_rootRenderTarget->_render(*this);
+
+		if (m_profiler)
+		{
+			m_profiler->endFrame();
+		}
+	}
+}
+
+void VisSystem::setProfilingEnabled(bool enabled)
+{
+	if (!enabled)
+	{
+		m_profiler.reset();
+	}
+	else if (!m_profiler)
+	{
+		m_profiler.reset(new FrameProfiler);
 	}
 }
 
@@ -72,71 +108,100 @@ static void applyWireframePolygonMode(bool wireframeModeEnabled)
 	}
 }
 
-void VisSystem::renderNode(const RenderableNodePtr& renderableNode, const Viewport& viewport, const CameraPtr& camera, TechniqueCategory category) const
+static size_t alignUp(size_t value, size_t alignment)
 {
-	applyWireframePolygonMode(m_wireframeModeEnabled || renderableNode->isWireframeModeEnabled());
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void VisSystem::_renderScene(const Viewport& viewport, const CameraPtr& camera, TechniqueCategory category) const
+{
+	Frustum frustum(camera->getViewProjectionMatrix());
+	const Frustum* cullingFrustum = m_frustumCullingEnabled ? &frustum : 0;
 
 	RenderContext context;
-	context.sceneNode = renderableNode;
 	context.camera = camera;
 	context.viewportResolution = glm::vec2(viewport.getWidth(), viewport.getHeight());
-	context.light = findNearestLight(renderableNode->getPosition());
 
-	renderableNode->render(context, category);
-}
+	FrameUniformBlock frameUniforms;
+	computeFrameUniformBlock(frameUniforms, *camera, context.viewportResolution);
+	context.frameUniforms = &frameUniforms;
 
-struct SortableRenderable
-{
-	float distanceSquared;
-	RenderableNodePtr renderableNode; 
-};
+	m_frameUniformBuffer->setData(&frameUniforms, sizeof(frameUniforms));
+	m_frameUniformBuffer->bindBase(UniformBlockBinding_Frame);
 
-static bool backToFrontPredicate(const SortableRenderable& a, const SortableRenderable& b)
-{
-	return a.distanceSquared > b.distanceSquared;
-}
+	size_t objectUniformStride = alignUp(sizeof(ObjectUniformBlock), UniformBuffer::getOffsetAlignment());
+
+	// GL state may have been changed outside the scene render, so the first technique always applies its full state
+	const Technique* previousTechnique = 0;
 
-void VisSystem::_renderScene(const Viewport& viewport, const CameraPtr& camera, TechniqueCategory category) const
-{
 	BOOST_FOREACH(const RenderQueues::value_type& value, m_renderQueues)
 	{
 		if (value.first & viewport.getRenderQueueIdMask())
 		{
-			const RenderQueue& queue = *value.second;
-			const RenderQueue::RenderableNodes& renderableNodes = queue.getRenderableNodes();
+			RenderQueue& queue = *value.second;
+			ProfileScope profileScope(m_profiler.get(), queue.getName());
 
-			switch(queue.getSortingMode())
+			const RenderQueue::DrawItems& drawItems = queue._prepareDrawItems(*camera, category, cullingFrustum);
+			if (drawItems.empty())
 			{
-			case RenderSortingMode_BackToFront:
+				continue;
+			}
+
+			// Compute uniforms once per visible node and upload them for the whole queue in one go
+			m_objectUniformSlots.assign(queue.getRenderableNodes().size(), -1);
+			int slotCount = 0;
+			BOOST_FOREACH(const RenderQueueDrawItem& item, drawItems)
+			{
+				int& slot = m_objectUniformSlots[item.renderableNodeIndex];
+				if (slot == -1)
 				{
-					std::vector<SortableRenderable> sortables;
-					BOOST_FOREACH(const RenderableNodePtr& renderableNode, renderableNodes)
-					{
-						SortableRenderable sortable;
-						glm::vec3 diff = camera->getPosition() - renderableNode->getPosition();
-						sortable.distanceSquared = glm::dot(diff, diff);
-						sortable.renderableNode = renderableNode;
-						sortables.push_back(sortable);
-					}
-
-					std::sort(sortables.begin(), sortables.end(), backToFrontPredicate);
-
-					BOOST_FOREACH(const SortableRenderable& sortable, sortables)
-					{
-						renderNode(sortable.renderableNode, viewport, camera, category);
-					}
+					slot = slotCount++;
 				}
-				break;
-			case RenderSortingMode_None:
+			}
+
+			m_objectUniformData.resize(slotCount * objectUniformStride);
+			for (int nodeIndex = 0; nodeIndex < (int)m_objectUniformSlots.size(); nodeIndex++)
+			{
+				int slot = m_objectUniformSlots[nodeIndex];
+				if (slot != -1)
 				{
-					BOOST_FOREACH(const RenderableNodePtr& renderableNode, renderableNodes)
-					{
-						renderNode(renderableNode, viewport, camera, category);
-					}
+					const RenderableNodePtr& renderableNode = queue.getRenderableNodes()[nodeIndex];
+					context.sceneNode = renderableNode;
+					context.light = findNearestLight(renderableNode->getPosition());
+
+					ObjectUniformBlock* block = reinterpret_cast<ObjectUniformBlock*>(&m_objectUniformData[slot * objectUniformStride]);
+					computeObjectUniformBlock(*block, context);
 				}
-				break;
-			default:
-				assert(!"Invalid sorting mode");
+			}
+			m_objectUniformBuffer->setData(&m_objectUniformData[0], m_objectUniformData.size());
+
+			int contextNodeIndex = -1;
+			int boundSlot = -1;
+			BOOST_FOREACH(const RenderQueueDrawItem& item, drawItems)
+			{
+				int slot = m_objectUniformSlots[item.renderableNodeIndex];
+				if (item.renderableNodeIndex != contextNodeIndex)
+				{
+					contextNodeIndex = item.renderableNodeIndex;
+					const RenderableNodePtr& renderableNode = queue.getRenderableNodes()[contextNodeIndex];
+					applyWireframePolygonMode(m_wireframeModeEnabled || renderableNode->isWireframeModeEnabled());
+
+					context.sceneNode = renderableNode;
+					context.light = findNearestLight(renderableNode->getPosition());
+					context.objectUniforms = reinterpret_cast<const ObjectUniformBlock*>(&m_objectUniformData[slot * objectUniformStride]);
+				}
+
+				if (slot != boundSlot && item.technique->_getShader()->hasUniformBlock(UniformBlockBinding_Object))
+				{
+					m_objectUniformBuffer->bindRange(UniformBlockBinding_Object, slot * objectUniformStride, sizeof(ObjectUniformBlock));
+					boundSlot = slot;
+				}
+
+				item.technique->updateShaderParameters(context);
+				item.technique->applyState(previousTechnique);
+				previousTechnique = item.technique;
+
+				item.renderable->doRender(context, category);
 			}
 		}
 	}
@@ -151,7 +216,7 @@ void VisSystem::addRenderableNode(const RenderableNodePtr& renderableNode, Rende
 	RenderQueues::iterator i = m_renderQueues.find(renderQueueId);
 	if (i == m_renderQueues.end())
 	{
-		std::pair<RenderQueues::iterator, bool> r = m_renderQueues.insert(RenderQueues::value_type(renderQueueId, RenderQueuePtr(new RenderQueue)));
+		std::pair<RenderQueues::iterator, bool> r = m_renderQueues.insert(RenderQueues::value_type(renderQueueId, createRenderQueue(renderQueueId)));
 		i = r.first;
 	}
 
@@ -170,6 +235,26 @@ void VisSystem::removeRenderableNode(const RenderableNodePtr& renderableNode)
 	renderableNode->m_renderQueueId = 0;
 }
 
+RenderQueuePtr VisSystem::createRenderQueue(int id)
+{
+	// Opaque geometry in the default queue is sorted by state to minimize program and texture binds
+	bool isDefault = (id == getDefaultRenderQueueId());
+	RenderSortingMode sortingMode = isDefault ? RenderSortingMode_State : RenderSortingMode_None;
+	RenderQueuePtr queue(new RenderQueue(sortingMode));
+
+	if (isDefault)
+	{
+		queue->setName("Opaque");
+	}
+	else
+	{
+		std::stringstream ss;
+		ss << "Queue " << id;
+		queue->setName(ss.str());
+	}
+	return queue;
+}
+
 RenderQueuePtr VisSystem::getRenderQueue(RenderQueueId id) const
 {
 	RenderQueues::const_iterator i = m_renderQueues.find(id);
@@ -25,6 +25,7 @@
 #include "TechniqueCategory.h"
 #include "RenderQueue.h"
 
+#include <boost/scoped_ptr.hpp>
 #include <vector>
 #include <map>
 
@@ -54,8 +55,19 @@ public:
 	void setWireframeModeEnabled(bool enabled) {m_wireframeModeEnabled = enabled;}
 	bool isWireframeModeEnabled() const {return m_wireframeModeEnabled;}
 
+	//! When enabled, nodes whose world bounds lie outside the frustum of the camera being rendered are skipped.
+	//! This applies to every viewport, including shadow projector viewports. Enabled by default.
+	void setFrustumCullingEnabled(bool enabled) {m_frustumCullingEnabled = enabled;}
+	bool isFrustumCullingEnabled() const {return m_frustumCullingEnabled;}
+
+	//! When enabled, render() times each render target and render queue on the CPU and GPU. Disabled by default.
+	void setProfilingEnabled(bool enabled);
+
+	//! Returns null if profiling is disabled
+	FrameProfiler* getProfiler() const {return m_profiler.get();}
+
 private:
-	void renderNode(const RenderableNodePtr& renderableNode, const Viewport& viewport, const CameraPtr& camera, TechniqueCategory category) const;
+	static RenderQueuePtr createRenderQueue(int id);
 
 	//! Can return null
 	LightPtr findNearestLight(const glm::vec3& position) const;
@@ -75,6 +87,16 @@ private:
 	static float ms_maxLightSearchRange;
 
 	bool m_wireframeModeEnabled;
+	bool m_frustumCullingEnabled;
+
+	boost::scoped_ptr<UniformBuffer> m_frameUniformBuffer;
+	boost::scoped_ptr<UniformBuffer> m_objectUniformBuffer;
+
+	boost::scoped_ptr<FrameProfiler> m_profiler;
+
+	// Scratch storage reused by _renderScene to avoid per-frame allocation
+	mutable std::vector<int> m_objectUniformSlots; //!< Slot in m_objectUniformData for each node in the queue, or -1 if not drawn
+	mutable std::vector<unsigned char> m_objectUniformData; //!< ObjectUniformBlocks at UBO offset alignment
 };
 
 } // namespace GVis
@@ -85,6 +85,7 @@ private:
 // ------------------------------------------------------------------
 
 Window::Window(const WindowConfig& config) :
+	RenderTarget("Window"),
 	m_width(config.width),
 	m_height(config.height),
 	m_mouseVisible(true),
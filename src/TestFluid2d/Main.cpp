@@ -22,6 +22,7 @@
 #include <GComputeVis/Convert.h>
 
 #include <GCommon/Logger.h>
+#include <GCompute/ClIncludes.h>
 #include <GCompute/ClSystem.h>
 
 #include <GFluid/FluidSolver.h>
@@ -34,6 +35,7 @@
 
 #include <exception>
 
+#include <boost/bind/bind.hpp>
 #include <boost/scoped_array.hpp>
 
 using namespace GAppFramework;
@@ -86,18 +88,25 @@ public:
 	}
 
 	void simulate(float dt)
+	{
+		simulateSteps(dt, 1);
+	}
+
+	void simulateSteps(float dt, int stepCount)
 	{ 
 		glm::vec2 mousePos = m_window->getMousePosition();
 		glm::vec2 mousePosInTexCoords(mousePos.x * (float)m_densityTextureConfig.width, (1.0f-mousePos.y) * (float)m_densityTextureConfig.height);
 
+		// Inject before every substep, as when steps were run one at a time
+		FluidSolver::SubstepCallback injectFluid;
 		if (m_window->isMousePressed(0))
 		{
 			float density = 2 * dt;
 			float temperature = 10;
-			m_solver->setFluid(Float3(mousePosInTexCoords.x, mousePosInTexCoords.y, 0), density, temperature);
+			injectFluid = boost::bind(&FluidSolver::setFluid, m_solver.get(), Float3(mousePosInTexCoords.x, mousePosInTexCoords.y, 0), density, temperature);
 		}
 
-		m_solver->update(dt);
+		waitForComplete(m_solver->update(dt, stepCount, injectFluid));
 	}
 
 private:
@@ -24,6 +24,7 @@
 #include <GComputeVis/Convert.h>
 
 #include <GCommon/Logger.h>
+#include <GCompute/ClIncludes.h>
 #include <GCompute/ClSystem.h>
 
 #include <GFluid/FluidSolver.h>
@@ -49,6 +50,7 @@
 #include <exception>
 #include <cstring>
 
+#include <boost/bind/bind.hpp>
 #include <boost/scoped_array.hpp>
 
 using namespace GAppFramework;
@@ -358,6 +360,11 @@ public:
 	}
 
 	void simulate(float dt)
+	{
+		simulateSteps(dt, 1);
+	}
+
+	void simulateSteps(float dt, int stepCount)
 	{
 		dt *= 3; // Take bigger steps to produce more turbulence / instability. Looks more interesting, but a bit dodgy.
 
@@ -366,9 +373,10 @@ public:
 		float density = 0.3;
 		float temperature = 1;
 		Float3 position(15 + x * (m_textureConfig.width - 30), 8, 15 + z * (m_textureConfig.depth -30));
-		m_solver->setFluid(position, density, temperature);
 
-		m_solver->update(dt);
+		// Inject before every substep, as when steps were run one at a time
+		FluidSolver::SubstepCallback injectFluid = boost::bind(&FluidSolver::setFluid, m_solver.get(), position, density, temperature);
+		waitForComplete(m_solver->update(dt, stepCount, injectFluid));
 		m_isosurfaceNormalCalculator->updateTexture();
 	}
 
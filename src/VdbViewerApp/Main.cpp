@@ -22,8 +22,12 @@
 #include <GAppFramework/RenderQueueIds.h>
 #include <GComputeVis/Convert.h>
 
+#include <GSparseVolumes/PagedRenderableVolume.h>
 #include <GSparseVolumes/RenderableVolumeFactory.h>
+#include <GSparseVolumes/VolumeInstanceSorter.h>
+#include <GSparseVolumes/VolumeLodSelector.h>
 #include <GSparseVolumesVdb/GridNormalCalculator.h>
+#include <GSparseVolumesVdb/VdbPreprocessing.h>
 #include <GSparseVolumesVdb/VdbUtil.h>
 #include <GSparseVolumesVdb/VdbGrid.h>
 
@@ -52,7 +56,14 @@
 #include <openvdb/tools/Interpolation.h>
 
 #include <exception>
-
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
 
 
@@ -70,17 +81,60 @@ enum GridTextureRole
 
 typedef std::map<GridTextureRole, GridPtr> GridTextureRolesMap;
 
+//! Raymarch settings which trade image quality for frame time
+struct RaymarchQuality
+{
+	int maxIterationCount;
+	float rayTerminationOpacity;
+	float stepDistanceGrowth; //!< Fractional step size increase per unit distance from the camera
+	float lowDensityStepMultiplier; //!< Step size multiplier after a sample below the alpha threshold
+};
+
+static RaymarchQuality createRaymarchQualityPreset(const std::string& name)
+{
+	RaymarchQuality quality;
+	if (name == "low")
+	{
+		quality.maxIterationCount = 100;
+		quality.rayTerminationOpacity = 0.95f;
+		quality.stepDistanceGrowth = 0.5f;
+		quality.lowDensityStepMultiplier = 4.0f;
+	}
+	else if (name == "medium")
+	{
+		quality.maxIterationCount = 200;
+		quality.rayTerminationOpacity = 0.98f;
+		quality.stepDistanceGrowth = 0.25f;
+		quality.lowDensityStepMultiplier = 2.0f;
+	}
+	else if (name == "high")
+	{
+		quality.maxIterationCount = 400;
+		quality.rayTerminationOpacity = 0.99f;
+		quality.stepDistanceGrowth = 0.0f;
+		quality.lowDensityStepMultiplier = 1.0f;
+	}
+	else
+	{
+		throw std::runtime_error("Unknown quality preset: " + name);
+	}
+	return quality;
+}
+
 class SparseVolumeMaterialFactoryI : public SparseVolumeMaterialFactory
 {
 public:
-	SparseVolumeMaterialFactoryI(const GridTextureRolesMap& gridRoles, bool transparent, float opacityMultiplier) :
+	//! @param instancedBoxes must be true if RenderableVolumeConfig::instanceBoxes is set
+	SparseVolumeMaterialFactoryI(const GridTextureRolesMap& gridRoles, bool transparent, float opacityMultiplier, bool instancedBoxes, const RaymarchQuality& quality) :
 		m_gridRoles(gridRoles),
 		m_transparent(transparent),
-		m_opacityMultiplier(opacityMultiplier)
+		m_opacityMultiplier(opacityMultiplier),
+		m_quality(quality),
+		m_volumeShaderConfig("Shaders/Volume/VdbRaymarchedVolume.vert", "Shaders/Volume/VdbRaymarchedVolume.frag")
 	{
-		ShaderProgramConfig config("Shaders/Volume/VdbRaymarchedVolume.vert", "Shaders/Volume/VdbRaymarchedVolume.frag");
-		
-		// Set shader macro definitions
+		ShaderProgramConfig& config = m_volumeShaderConfig;
+
+		// Set shader macro definitions. Macros which depend on the atlases are added per material by getVolumeShader().
 		if (m_gridRoles.find(GridTextureRole_Normal) != m_gridRoles.end())
 		{
 			config.macroDefinitions.push_back("USE_NORMAL_SAMPLER");
@@ -91,8 +145,11 @@ public:
 			config.macroDefinitions.push_back("USE_TEMPERATURE_SAMPLER");
 		}
 
-		// Create shader
-		m_volumeShader = ShaderProgram::createShaderProgram(config);
+		if (instancedBoxes)
+		{
+			config.macroDefinitions.push_back("USE_INSTANCED_BOXES");
+		}
+
 		m_temperatureRampTexture = DdsLoader::load("Textures/TemperatureRamp.dds", ColorSpace_SRGB);
 		m_temperatureRampTexture->setTextureAddressMode(TextureAddressMode_Clamp);
 	}
@@ -113,7 +170,7 @@ public:
 
 		// Main technique
 		{
-			TechniquePtr technique(new Technique(m_volumeShader));
+			TechniquePtr technique(new Technique(getVolumeShader(config)));
 			{
 				Vec3ShaderParameterPtr boxModelSizeParameter(new Vec3ShaderParameter("volumeSize_modelSpace", config.boxSize));
 				technique->addCustomShaderParameter(boxModelSizeParameter);
@@ -129,6 +186,8 @@ public:
 				technique->addCustomShaderParameter(ShaderParameterPtr(new IntShaderParameter("maxLeafCountPerInternalNode", maxLeafCountPerInternalNode)));
 				technique->addCustomShaderParameter(ShaderParameterPtr(new IVec3ShaderParameter("maxLeafCountPerAtlasDimension", config.maxLeafCountPerAtlasDimension)));
 				technique->addCustomShaderParameter(ShaderParameterPtr(new IntShaderParameter("maxLeafCountPerInternalNodeDimension", config.maxLeafCountPerInternalNodeDimension)));
+				technique->addCustomShaderParameter(ShaderParameterPtr(new IntShaderParameter("leafVoxelCountPerDimension", config.leafVoxelCountPerDimension)));
+				technique->addCustomShaderParameter(ShaderParameterPtr(new FloatShaderParameter("stepSizeScale", float(1 << config.lodLevel))));
 				
 				float thresholdAlpha = m_transparent ? 0.001 : 0.2;
 				technique->addCustomShaderParameter(ShaderParameterPtr(new FloatShaderParameter("thresholdAlpha", thresholdAlpha)));
@@ -136,6 +195,11 @@ public:
 				float opacityMultiplier = m_transparent ? m_opacityMultiplier : 200.0;
 				technique->addCustomShaderParameter(ShaderParameterPtr(new FloatShaderParameter("opacityMultiplier", opacityMultiplier)));
 
+				technique->addCustomShaderParameter(ShaderParameterPtr(new IntShaderParameter("maxIterationCount", m_quality.maxIterationCount)));
+				technique->addCustomShaderParameter(ShaderParameterPtr(new FloatShaderParameter("rayTerminationOpacity", m_quality.rayTerminationOpacity)));
+				technique->addCustomShaderParameter(ShaderParameterPtr(new FloatShaderParameter("stepDistanceGrowth", m_quality.stepDistanceGrowth)));
+				technique->addCustomShaderParameter(ShaderParameterPtr(new FloatShaderParameter("lowDensityStepMultiplier", m_quality.lowDensityStepMultiplier)));
+
 				{
 					TextureUnit unit(densityTexture, "albedoSampler");
 					technique->addTextureUnit(unit);
@@ -169,6 +233,56 @@ public:
 	}
 
 private:
+	//! Returns the volume shader with sampler types and normal decoding matching the material's atlases
+	ShaderProgramPtr getVolumeShader(const SparseVolumeMaterialConfig& materialConfig) const
+	{
+		std::vector<std::string> atlasMacros;
+		if (isBlockCompressedVoxelFormat(getFormatForRole(materialConfig.leafAtlasFormats, GridTextureRole_Diffuse)))
+		{
+			atlasMacros.push_back("ALBEDO_ATLAS_ARRAY");
+		}
+
+		VoxelFormat normalFormat = getFormatForRole(materialConfig.leafAtlasFormats, GridTextureRole_Normal);
+		if (isBlockCompressedVoxelFormat(normalFormat))
+		{
+			atlasMacros.push_back("NORMAL_ATLAS_ARRAY");
+		}
+		if (normalFormat == VoxelFormat_BC5)
+		{
+			atlasMacros.push_back("USE_OCTAHEDRAL_NORMALS");
+		}
+
+		if (isBlockCompressedVoxelFormat(getFormatForRole(materialConfig.leafAtlasFormats, GridTextureRole_Temperature)))
+		{
+			atlasMacros.push_back("TEMPERATURE_ATLAS_ARRAY");
+		}
+
+		// Every material of a volume shares a variant, so look it up here rather than preprocessing the sources per material
+		ShaderProgramPtr& shader = m_volumeShaders[atlasMacros];
+		if (!shader)
+		{
+			ShaderProgramConfig config = m_volumeShaderConfig;
+			config.macroDefinitions.insert(config.macroDefinitions.end(), atlasMacros.begin(), atlasMacros.end());
+			shader = ShaderProgram::createShaderProgram(config);
+		}
+		return shader;
+	}
+
+	VoxelFormat getFormatForRole(const GridVoxelFormatsMap& formats, GridTextureRole role) const
+	{
+		GridTextureRolesMap::const_iterator i = m_gridRoles.find(role);
+		if (i != m_gridRoles.end())
+		{
+			GridVoxelFormatsMap::const_iterator j = formats.find(i->second);
+			if (j != formats.end())
+			{
+				return j->second;
+			}
+		}
+
+		return VoxelFormat_UNorm8;
+	}
+
 	TexturePtr getGridForRole(const GridTexturesMap& textures, GridTextureRole role) const
 	{
 		TexturePtr result;
@@ -187,13 +301,36 @@ private:
 	}
 
 private:
-	ShaderProgramPtr m_volumeShader;
 	TexturePtr m_temperatureRampTexture;
 	GridTextureRolesMap m_gridRoles;
 	bool m_transparent;
 	float m_opacityMultiplier;
+	RaymarchQuality m_quality;
+	ShaderProgramConfig m_volumeShaderConfig;
+	mutable std::map<std::vector<std::string>, ShaderProgramPtr> m_volumeShaders; //!< Keyed by atlas dependent macro definitions
 };
 
+static VoxelFormat parseVoxelFormat(const std::string& name)
+{
+	if (name == "unorm8") return VoxelFormat_UNorm8;
+	if (name == "unorm16") return VoxelFormat_UNorm16;
+	if (name == "float16") return VoxelFormat_Float16;
+	if (name == "bc4") return VoxelFormat_BC4;
+	if (name == "bc5") return VoxelFormat_BC5;
+	throw std::runtime_error("Unknown voxel format: " + name);
+}
+
+//! 64 bit FNV-1a hash
+static boost::uint64_t hashBytes(const char* data, size_t size, boost::uint64_t hash = 14695981039346656037ULL)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
 struct DemoAppConfig : ApplicationConfig
 {
 	DemoAppConfig() :
@@ -201,7 +338,15 @@ struct DemoAppConfig : ApplicationConfig
 		transparent(false),
 		orbitCam(true),
 		renderToLowResTarget(true),
-		opacityMultiplier(1.0)
+		opacityMultiplier(1.0),
+		buildThreadCount(0),
+		pagedCacheLeafCount(0),
+		lodLevelCount(1),
+		scalarVoxelFormat(VoxelFormat_UNorm8),
+		normalVoxelFormat(VoxelFormat_UNorm8),
+		raymarchQuality(createRaymarchQualityPreset("medium")),
+		atlasCacheDirectory("AtlasCache"),
+		shaderCacheDirectory("ShaderCache")
 	{
 	}
 
@@ -219,6 +364,29 @@ struct DemoAppConfig : ApplicationConfig
 
 	//! When enabled, improves performance by rendering output to a low res full-screen texture
 	bool renderToLowResTarget;
+
+	//! Number of threads used to build texture atlases. 0 uses all hardware threads.
+	int buildThreadCount;
+
+	//! When non-zero, leaves are paged on demand through a GPU brick cache of this many leaves
+	int pagedCacheLeafCount;
+
+	//! Number of atlas resolutions to build. 1 disables LOD.
+	int lodLevelCount;
+
+	//! Atlas format for density and temperature grids
+	VoxelFormat scalarVoxelFormat;
+
+	//! Atlas format for the normal grid
+	VoxelFormat normalVoxelFormat;
+
+	RaymarchQuality raymarchQuality;
+
+	//! Directory of precomputed atlas cache files. Caching is disabled if empty.
+	std::string atlasCacheDirectory;
+
+	//! Directory of linked shader program binaries. Caching is disabled if empty.
+	std::string shaderCacheDirectory;
 };
 
 class DemoApplication : public Application
@@ -259,12 +427,6 @@ public:
 		return target;
 	}
 
-	struct CopyBIntoA {
-		inline void operator()(const float& a, const float& b, float& result) const {
-			result = a;
-		}
-	};
-
 	void setupScene()
 	{
 		m_window->getViewports().front()->setRenderQueueIdMask(~RenderQueueId_OffscreenTransparentObjects);
@@ -274,82 +436,6 @@ public:
 		light->setPosition(glm::vec3(0, 0.5, 0) + light->getDirection() * -10.0f);
 		m_visSystem->addLight(light);
 
-		// Volume
-		std::vector<std::string> gridNames;
-		gridNames.push_back(m_config.densityGridName);
-
-		if (!m_config.temperatureGridName.empty())
-		{
-			gridNames.push_back(m_config.temperatureGridName);
-		}
-
-		std::vector<openvdb::GridBase::Ptr> baseGrids = loadGridsFromFile(m_config.vdbVilename, gridNames);
-
-		openvdb::FloatGrid::Ptr densityGrid = openvdb::gridPtrCast<openvdb::FloatGrid>(baseGrids[0]);
-
-		openvdb::FloatGrid::Ptr temperatureGrid;
-		if (!m_config.temperatureGridName.empty())
-		{
-			temperatureGrid = openvdb::gridPtrCast<openvdb::FloatGrid>(baseGrids[1]);
-
-			// Rescale temperature field to between 0 and 1
-			{
-				float minValue = 99999999999999;
-				float maxValue = -99999999999999;
-				for (openvdb::FloatGrid::ValueOnCIter iter = temperatureGrid->cbeginValueOn(); iter.test(); ++iter) {
-					float value = *iter;
-					minValue = std::min(minValue, value);
-					maxValue = std::max(maxValue, value);
-				}
-
-				float scale = 1.0 / (maxValue - minValue);
-
-				for (openvdb::FloatGrid::ValueOnIter iter = temperatureGrid->beginValueOn(); iter.test(); ++iter) {
-					float value = *iter;
-					value = (value - minValue) * scale;
-					iter.setValue(value);
-				}
-			}
-
-			// Ensure both grids have the same hierarchy
-			{
-				openvdb::FloatGrid::Ptr resultGrid = openvdb::FloatGrid::create();
-				resultGrid->tree().combine2(densityGrid->tree(), temperatureGrid->tree(), CopyBIntoA());
-				temperatureGrid->tree().combine(densityGrid->tree(), CopyBIntoA());
-
-				densityGrid = resultGrid; 
-			}
-		}
-
-		std::vector<GridPtr> grids;
-		GridTextureRolesMap gridTextureRoles;
-
-		grids.push_back(GridPtr(new VdbGrid<openvdb::FloatGrid>(densityGrid, 1)));
-		gridTextureRoles[GridTextureRole_Diffuse] = grids.back();
-
-		if (m_config.generateNormals)
-		{
-			Vec3UByteGrid::Ptr normalGrid = createNormalGrid(*densityGrid);
-			grids.push_back(GridPtr(new VdbGrid<Vec3UByteGrid>(normalGrid, 3)));
-			gridTextureRoles[GridTextureRole_Normal] = grids.back();
-		}
-
-		if (temperatureGrid)
-		{
-			grids.push_back(GridPtr(new VdbGrid<openvdb::FloatGrid>(temperatureGrid, 1)));
-			gridTextureRoles[GridTextureRole_Temperature] = grids.back();
-		}
-
-		openvdb::CoordBBox bbox;
-		densityGrid->constTree().evalLeafBoundingBox(bbox);
-
-		float scale = 1.0f / (float)bbox.extents().asVec3s().length();
-
-		glm::vec3 center = toVec3(bbox.getCenter() * scale);
-		std::ostringstream ss;
-		ss << "Grid extents: " << bbox.extents().x() << ", " << bbox.extents().y() << ", " << bbox.extents().z();
-		defaultLogger()->logLine(ss.str());
-
 		int renderQueueId;
 		if (m_config.renderToLowResTarget)
 		{
@@ -360,16 +446,8 @@ public:
 			renderQueueId = getDefaultRenderQueueId();
 		}
 
-		RenderableVolumeConfig config;
-		config.grids = grids;
-		config.materialFactory.reset(new SparseVolumeMaterialFactoryI(gridTextureRoles, m_config.transparent, m_config.opacityMultiplier));
-		config.scale = scale;
-		config.batchBoxes = !m_config.transparent; // don't batch if we have transparency so we can sort
-
-		RenderableVolumePtr volume = RenderableVolumeFactory::createRenderableVolume(config);
-		BOOST_FOREACH(const GVis::RenderableNodePtr& node, volume->nodes)
+		BOOST_FOREACH(const GVis::RenderableNodePtr& node, createVolumeNodes())
 		{
-			node->translate(-center);
 			m_visSystem->addRenderableNode(node, renderQueueId);
 		}
 
@@ -377,7 +455,10 @@ public:
 		{
 			RenderQueuePtr renderQueue = m_visSystem->getRenderQueue(renderQueueId);
 			if (renderQueue)
+			{
 				renderQueue->setSortingMode(RenderSortingMode_BackToFront);
+				renderQueue->setName("Transparent");
+			}
 		}
 
 		if (m_config.renderToLowResTarget)
@@ -399,6 +480,7 @@ public:
 					config.texture = offscreenTransparentObjectsTexture;
 					config.attachment = FrameBufferAttachment_Color;
 					RenderTextureTargetPtr target(new RenderTextureTarget(config));
+					target->setName("OffscreenTransparent");
 
 					{
 						ViewportPtr viewport = target->addDefaultViewport(m_camera);
@@ -441,6 +523,199 @@ public:
 		m_camera->setPosition_parentSpace(glm::vec3(0,0,1.4));
 	}
 
+	//! Loads the volume from the atlas cache if possible, otherwise builds it from the vdb file and writes the cache
+	std::vector<RenderableNodePtr> createVolumeNodes()
+	{
+		// The paged volume streams leaves from the vdb grids, so can't use the cache
+		std::string cacheFilename;
+		if (!m_config.atlasCacheDirectory.empty() && m_config.pagedCacheLeafCount == 0)
+		{
+			cacheFilename = getAtlasCacheFilename();
+		}
+
+		RenderableVolumeConfig config;
+		config.batchBoxes = !m_config.transparent; // don't batch if we have transparency so we can sort
+		config.instanceBoxes = isInstancingBoxes();
+		config.buildThreadCount = m_config.buildThreadCount;
+		config.lodLevelCount = m_config.lodLevelCount;
+
+		RenderableVolumePtr volume;
+		if (!cacheFilename.empty() && boost::filesystem::exists(cacheFilename))
+		{
+			try
+			{
+				GridTextureRolesMap gridTextureRoles;
+				createPlaceholderGrids(config, gridTextureRoles);
+				config.materialFactory = createMaterialFactory(gridTextureRoles);
+				volume = RenderableVolumeFactory::loadRenderableVolume(cacheFilename, config);
+				defaultLogger()->logLine("Loaded atlas cache: " + cacheFilename);
+			}
+			catch (const std::exception& e)
+			{
+				defaultLogger()->logLine(std::string("Ignoring atlas cache: ") + e.what());
+				config.grids.clear();
+				config.voxelFormats.clear();
+			}
+		}
+
+		if (!volume)
+		{
+			GridTextureRolesMap gridTextureRoles;
+			loadGrids(config, gridTextureRoles);
+			config.materialFactory = createMaterialFactory(gridTextureRoles);
+
+			if (m_config.pagedCacheLeafCount > 0)
+			{
+				PagedVolumeConfig pagedConfig;
+				pagedConfig.cacheLeafCount = m_config.pagedCacheLeafCount;
+				m_pagedVolume.reset(new PagedRenderableVolume(config, pagedConfig));
+				return m_pagedVolume->getNodes();
+			}
+
+			if (!cacheFilename.empty())
+			{
+				// The cache is an optimization, so build without it if the directory can't be created (e.g. read only working directory)
+				try
+				{
+					boost::filesystem::create_directories(m_config.atlasCacheDirectory);
+					config.cacheFilename = cacheFilename;
+				}
+				catch (const std::exception& e)
+				{
+					defaultLogger()->logLine(std::string("Not writing atlas cache: ") + e.what());
+					config.cacheFilename.clear();
+				}
+			}
+			volume = RenderableVolumeFactory::createRenderableVolume(config);
+		}
+
+		m_lodSelector.reset(new VolumeLodSelector(volume));
+		if (!volume->instancedBoxes.empty())
+		{
+			m_instanceSorter.reset(new VolumeInstanceSorter(volume));
+		}
+		return volume->nodes;
+	}
+
+	//! Loads grids from the vdb file into config, with scale and offset set to fit the volume into a unit box at the origin
+	void loadGrids(RenderableVolumeConfig& config, GridTextureRolesMap& gridTextureRoles)
+	{
+		std::vector<std::string> gridNames;
+		gridNames.push_back(m_config.densityGridName);
+
+		if (!m_config.temperatureGridName.empty())
+		{
+			gridNames.push_back(m_config.temperatureGridName);
+		}
+
+		std::vector<openvdb::GridBase::Ptr> baseGrids = loadGridsFromFile(m_config.vdbVilename, gridNames);
+
+		openvdb::FloatGrid::Ptr densityGrid = openvdb::gridPtrCast<openvdb::FloatGrid>(baseGrids[0]);
+
+		openvdb::FloatGrid::Ptr temperatureGrid;
+		if (!m_config.temperatureGridName.empty())
+		{
+			temperatureGrid = openvdb::gridPtrCast<openvdb::FloatGrid>(baseGrids[1]);
+
+			normalizeActiveValues(*temperatureGrid);
+
+			// Ensure both grids have the same hierarchy
+			unionTopology(*densityGrid, *temperatureGrid);
+		}
+
+		config.grids.push_back(GridPtr(new VdbGrid<openvdb::FloatGrid>(densityGrid, 1)));
+		gridTextureRoles[GridTextureRole_Diffuse] = config.grids.back();
+		config.voxelFormats[config.grids.back()] = m_config.scalarVoxelFormat;
+
+		if (m_config.generateNormals)
+		{
+			Vec3UByteGrid::Ptr normalGrid = createNormalGrid(*densityGrid);
+			config.grids.push_back(GridPtr(new VdbGrid<Vec3UByteGrid>(normalGrid, 3)));
+			gridTextureRoles[GridTextureRole_Normal] = config.grids.back();
+			config.voxelFormats[config.grids.back()] = m_config.normalVoxelFormat;
+		}
+
+		if (temperatureGrid)
+		{
+			config.grids.push_back(GridPtr(new VdbGrid<openvdb::FloatGrid>(temperatureGrid, 1)));
+			gridTextureRoles[GridTextureRole_Temperature] = config.grids.back();
+			config.voxelFormats[config.grids.back()] = m_config.scalarVoxelFormat;
+		}
+
+		openvdb::CoordBBox bbox;
+		densityGrid->constTree().evalLeafBoundingBox(bbox);
+
+		config.scale = 1.0f / (float)bbox.extents().asVec3s().length();
+		config.offset = -toVec3(bbox.getCenter() * config.scale);
+
+		std::ostringstream ss;
+		ss << "Grid extents: " << bbox.extents().x() << ", " << bbox.extents().y() << ", " << bbox.extents().z();
+		defaultLogger()->logLine(ss.str());
+	}
+
+	//! Creates empty grids with the same roles, order and channel counts as loadGrids(), for use as atlas keys when loading from the cache
+	void createPlaceholderGrids(RenderableVolumeConfig& config, GridTextureRolesMap& gridTextureRoles)
+	{
+		config.grids.push_back(GridPtr(new VdbGrid<openvdb::FloatGrid>(openvdb::FloatGrid::create(), 1)));
+		gridTextureRoles[GridTextureRole_Diffuse] = config.grids.back();
+		config.voxelFormats[config.grids.back()] = m_config.scalarVoxelFormat;
+
+		if (m_config.generateNormals)
+		{
+			config.grids.push_back(GridPtr(new VdbGrid<Vec3UByteGrid>(Vec3UByteGrid::create(), 3)));
+			gridTextureRoles[GridTextureRole_Normal] = config.grids.back();
+			config.voxelFormats[config.grids.back()] = m_config.normalVoxelFormat;
+		}
+
+		if (!m_config.temperatureGridName.empty())
+		{
+			config.grids.push_back(GridPtr(new VdbGrid<openvdb::FloatGrid>(openvdb::FloatGrid::create(), 1)));
+			gridTextureRoles[GridTextureRole_Temperature] = config.grids.back();
+			config.voxelFormats[config.grids.back()] = m_config.scalarVoxelFormat;
+		}
+	}
+
+	SparseVolumeMaterialFactoryPtr createMaterialFactory(const GridTextureRolesMap& gridTextureRoles) const
+	{
+		return SparseVolumeMaterialFactoryPtr(new SparseVolumeMaterialFactoryI(gridTextureRoles, m_config.transparent, m_config.opacityMultiplier,
+																			   isInstancingBoxes(), m_config.raymarchQuality));
+	}
+
+	//! Transparent volumes draw each atlas's boxes with one instanced draw call, sorted back to front by m_instanceSorter.
+	//! The paged volume draws one box per node so it can hide non resident nodes.
+	bool isInstancingBoxes() const
+	{
+		return m_config.transparent && m_config.pagedCacheLeafCount == 0;
+	}
+
+	/*! Cache files are keyed by the vdb file's path, size and modification time, and every option which affects the built atlases.
+		The file contents are not hashed because reading a large vdb file on every launch would cost most of what the cache saves.
+	*/
+	std::string getAtlasCacheFilename() const
+	{
+		boost::filesystem::path vdbPath = boost::filesystem::absolute(m_config.vdbVilename);
+
+		std::ostringstream options;
+		options << "version=3"
+				<< " file=" << vdbPath.string()
+				<< " size=" << boost::filesystem::file_size(vdbPath)
+				<< " modified=" << boost::filesystem::last_write_time(vdbPath)
+				<< " density=" << m_config.densityGridName
+				<< " temperature=" << m_config.temperatureGridName
+				<< " normals=" << m_config.generateNormals
+				<< " batchBoxes=" << !m_config.transparent
+				<< " lodLevels=" << m_config.lodLevelCount
+				<< " scalarFormat=" << m_config.scalarVoxelFormat
+				<< " normalFormat=" << m_config.normalVoxelFormat;
+		std::string optionsString = options.str();
+
+		boost::uint64_t hash = hashBytes(optionsString.c_str(), optionsString.size());
+
+		std::ostringstream filename;
+		filename << std::hex << std::setw(16) << std::setfill('0') << hash << ".gsvc";
+		return (boost::filesystem::path(m_config.atlasCacheDirectory) / filename.str()).string();
+	}
+
 	void render()
 	{
 
@@ -453,6 +728,22 @@ public:
 			centerNode->setOrientation(ori);
 		}
 
+		if (m_pagedVolume)
+		{
+			m_pagedVolume->update(*m_camera);
+		}
+
+		if (m_lodSelector)
+		{
+			int volumeTargetHeight = m_config.renderToLowResTarget ? m_window->getHeight() / 2 : m_window->getHeight();
+			m_lodSelector->update(*m_camera, volumeTargetHeight);
+		}
+
+		if (m_instanceSorter)
+		{
+			m_instanceSorter->update(*m_camera);
+		}
+
 		Application::render();
 	}
 
@@ -460,6 +751,9 @@ public:
 
 private:
 	SceneNodePtr centerNode;
+	boost::scoped_ptr<PagedRenderableVolume> m_pagedVolume;
+	boost::scoped_ptr<VolumeLodSelector> m_lodSelector;
+	boost::scoped_ptr<VolumeInstanceSorter> m_instanceSorter;
 	DemoAppConfig m_config;
 	bool m_orbitCam;
 };
@@ -475,6 +769,9 @@ int main(int argc, char** argv)
 		namespace po = boost::program_options;
 
 		DemoAppConfig config;
+		std::string scalarFormatName;
+		std::string normalFormatName;
+		std::string qualityName;
 
 		// read command line options
 		po::options_description description("VdbViewer");
@@ -488,7 +785,17 @@ int main(int argc, char** argv)
 		("generateNormals,n", "generate normals")
 		("orbit,c", "orbit camera")
 		("lowres,r", "render to low resolution framebuffer")
-		("transparent,t", "render as transparent volume");
+		("transparent,t", "render as transparent volume")
+		("buildThreads", po::value<int>(&config.buildThreadCount)->default_value(0), "number of threads used to build texture atlases (0 = all hardware threads)")
+		("pagedCacheLeaves", po::value<int>(&config.pagedCacheLeafCount)->default_value(0), "page leaves on demand through a GPU cache of this many leaves (0 = load all leaves up front)")
+		("lodLevels", po::value<int>(&config.lodLevelCount)->default_value(1), "number of atlas resolutions to build, each half the previous (1 = full resolution only)")
+		("quality", po::value<std::string>(&qualityName)->default_value("medium"), "raymarch quality preset: low, medium or high")
+		("scalarFormat", po::value<std::string>(&scalarFormatName)->default_value("unorm8"), "density and temperature atlas format: unorm8, unorm16, float16 or bc4")
+		("normalFormat", po::value<std::string>(&normalFormatName)->default_value("unorm8"), "normal atlas format: unorm8 or bc5")
+		("atlasCacheDir", po::value<std::string>(&config.atlasCacheDirectory)->default_value("AtlasCache"), "directory of precomputed atlas cache files")
+		("noAtlasCache", "always build atlases from the vdb file and don't write a cache file")
+		("shaderCacheDir", po::value<std::string>(&config.shaderCacheDirectory)->default_value("ShaderCache"), "directory of linked shader program binaries (empty = compile shaders every run)")
+		("profile", po::value<float>(), "log CPU and GPU time of each render pass every this many seconds");
 
 		po::variables_map vm;
 		po::store(program_options::command_line_parser(argc, argv).options(description).run(), vm);
@@ -505,6 +812,14 @@ int main(int argc, char** argv)
 			config.transparent = vm.count("transparent");
 			config.orbitCam = vm.count("orbit");
 			config.renderToLowResTarget = vm.count("lowres");
+			config.scalarVoxelFormat = parseVoxelFormat(scalarFormatName);
+			config.normalVoxelFormat = parseVoxelFormat(normalFormatName);
+			config.raymarchQuality = createRaymarchQualityPreset(qualityName);
+
+			if (vm.count("noAtlasCache"))
+			{
+				config.atlasCacheDirectory.clear();
+			}
 			
 			if (!vm.count("useTemperatureGrid"))
 			{
@@ -512,7 +827,13 @@ int main(int argc, char** argv)
 			}
 			config.windowConfig.antiAliasingSampleCount = 0; // MSAA is probably overkill, disable it for performance
 
+			ShaderProgram::setBinaryCacheDirectory(config.shaderCacheDirectory);
+
 			DemoApplication app(config);
+			if (vm.count("profile"))
+			{
+				app.setProfileReportInterval(vm["profile"].as<float>());
+			}
 			app.run();
 		}
 	}